@@ -34,9 +34,13 @@ if(USE_OPENMP)
   # However, this naïve method will force any user of Caffe to add the same kludge
   # into their buildsystem again, so we put these options into per-target PUBLIC
   # compile options and link flags, so that they will be exported properly.
-  find_package(OpenMP REQUIRED)
-  list(APPEND Caffe_LINKER_LIBS PRIVATE ${OpenMP_CXX_FLAGS})
-  list(APPEND Caffe_COMPILE_OPTIONS PRIVATE ${OpenMP_CXX_FLAGS})
+  # The CPU layers use OpenMP pragmas, which are simply ignored without it.
+  # The flags are C++ only since the same target also has CUDA sources.
+  find_package(OpenMP)
+  if(OPENMP_FOUND)
+    list(APPEND Caffe_LINKER_LIBS PRIVATE ${OpenMP_CXX_FLAGS})
+    list(APPEND Caffe_COMPILE_OPTIONS PRIVATE $<$<COMPILE_LANGUAGE:CXX>:${OpenMP_CXX_FLAGS}>)
+  endif()
 endif()
 
 # ---[ Google-glog
@@ -275,6 +275,14 @@ class Blob {
    * shared_ptr calls its destructor when reset with the "=" operator.
    */
   void ShareDiff(const Blob& other);
+  /**
+   * @brief Set the data_ shared_ptr to memory, which must be able to hold
+   *        count() elements -- used by Net to let blobs that are not needed
+   *        at the same time share memory.
+   */
+  void UseDataMemory(const shared_ptr<SyncedMemory>& memory);
+  /// @brief Set the diff_ shared_ptr to memory; see UseDataMemory.
+  void UseDiffMemory(const shared_ptr<SyncedMemory>& memory);
 
   bool ShapeEquals(const BlobProto& other);
 
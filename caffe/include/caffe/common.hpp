@@ -149,6 +149,11 @@ class Caffe {
   //return if cudnn is enabled
   inline static bool cudnn_enabled() { return Get().cudnn_enabled_; }
   inline static void set_cudnn(bool enable) { Get().cudnn_enabled_ = enable; }
+  // Number of OpenMP threads this thread's CPU layers may use; a value of
+  // zero (the default) means the OpenMP default, normally one per core.
+  // Returns 1 when Caffe is built without OpenMP.
+  static int cpu_threads();
+  inline static void set_cpu_threads(int n) { Get().cpu_threads_ = n; }
 
   // Sets the random seed of both boost and curand
   static void set_random_seed(const unsigned int seed);
@@ -181,6 +186,7 @@ class Caffe {
 
   Brew mode_;
   bool cudnn_enabled_; //global switch for cudnn
+  int cpu_threads_;
 
   // Parallel training
   int solver_count_;
@@ -36,6 +36,17 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   void forward_cpu_gemm(const Dtype* input, const Dtype* weights,
       Dtype* output, bool skip_im2col = false);
   void forward_cpu_bias(Dtype* output, const Dtype* bias);
+  // forward_cpu_gemm using only the nonzero input channels; returns false
+  // (and does nothing) if there are no zero channels to skip
+  bool forward_cpu_sparse_gemm(const Dtype* input, const Dtype* weights,
+      Dtype* output);
+  // output = weights (conv_out_channels_ x K) * col_buff (K x out spatial)
+  // computed with int8 weights, scaled by weight_scales_, and activations
+  void forward_cpu_gemm_int8(const int K, const int8_t* weights,
+      const Dtype* col_buff, Dtype* output);
+  // quantize the weights into int8_weights_ unless they are unchanged since
+  // the last call
+  void quantize_weights_int8();
   void backward_cpu_gemm(const Dtype* input, const Dtype* weights,
       Dtype* output);
   void weight_cpu_gemm(const Dtype* input, const Dtype* output, Dtype*
@@ -98,6 +109,8 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   bool bias_term_;
   bool is_1x1_;
   bool force_nd_im2col_;
+  bool skip_zero_channels_;
+  bool quantize_int8_;
 
  private:
   // wrap im2col/col2im so we don't have to remember the (long) argument lists
@@ -173,6 +186,12 @@ class BaseConvolutionLayer : public Layer<Dtype> {
 
   Blob<Dtype> col_buffer_;
   Blob<Dtype> bias_multiplier_;
+  Blob<Dtype> compact_weights_;  // weights of nonzero input channels
+  // quantized operands of forward_cpu_gemm_int8 and their row scales;
+  // int8_compact_ holds the columns of int8_weights_ of nonzero input channels
+  vector<int8_t> int8_weights_, int8_compact_, int8_cols_;
+  vector<float> weight_scales_, col_scales_;
+  unsigned long int8_weights_version_;  // version of the quantized weights
 };
 
 }  // namespace caffe
@@ -47,6 +47,10 @@ class InnerProductLayer : public Layer<Dtype> {
   bool bias_term_;
   Blob<Dtype> bias_multiplier_;
   bool transpose_;  ///< if true, assume transposed weights
+  bool quantize_int8_;  ///< if true, CPU forward uses int8 products
+  vector<int8_t> int8_bottom_, int8_weights_;
+  vector<float> bottom_scales_, weight_scales_;
+  unsigned long int8_weights_version_;  ///< version of the quantized weights
 };
 
 }  // namespace caffe
@@ -279,6 +279,12 @@ class Net {
   void AppendParam(const NetParameter& param, const int layer_id,
                    const int param_id);
 
+  /// @brief Let blobs with disjoint lifetimes share memory (memory_plan).
+  void PlanMemory(const NetParameter& param);
+  /// @brief Assign shared data (or diff) memory to the blobs not marked fixed.
+  size_t ShareBlobMemory(const vector<int>& first_use,
+      const vector<int>& last_use, const vector<bool>& fixed, bool diff);
+
   /// @brief Helper for displaying debug info in Forward.
   void ForwardDebugInfo(const int layer_id);
   /// @brief Helper for displaying debug info in Backward.
@@ -68,6 +68,9 @@ class SyncedMemory {
   enum SyncedHead { UNINITIALIZED, HEAD_AT_CPU, HEAD_AT_GPU, SYNCED };
   SyncedHead head() { return head_; }
   size_t size() { return size_; }
+  // changes whenever the data may have been modified; versions are unique
+  // across all SyncedMemory objects so a cached copy can be keyed on them
+  unsigned long version() const { return version_; }
   void clear();
 
 #ifndef CPU_ONLY
@@ -87,6 +90,7 @@ class SyncedMemory {
   bool cpu_malloc_use_cuda_;
   bool own_gpu_data_;
   int device_;
+  unsigned long version_;
 
   DISABLE_COPY_AND_ASSIGN(SyncedMemory);
 };  // class SyncedMemory
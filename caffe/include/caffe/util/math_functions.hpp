@@ -31,6 +31,27 @@ void caffe_cpu_gemv(const CBLAS_TRANSPOSE TransA, const int M, const int N,
     const Dtype alpha, const Dtype* A, const Dtype* x, const Dtype beta,
     Dtype* y);
 
+// Reduced precision inference: C = A * B^T (M x N) where A (M x K) and
+// B (N x K) have been quantized to int8 one row at a time, e.g. by
+// caffe_cpu_quantize_rows; products are accumulated exactly in 32 bits and
+// scaled back by the scales of both rows.
+template <typename Dtype>
+void caffe_cpu_gemm_int8(const int M, const int N, const int K,
+    const int8_t* A, const float* a_scale, const int8_t* B,
+    const float* b_scale, Dtype* C);
+
+// Symmetric int8 quantization of each row of the rows x cols matrix X;
+// row r is approximately q[r] * scale[r].
+template <typename Dtype>
+void caffe_cpu_quantize_rows(const int rows, const int cols, const Dtype* X,
+    int8_t* q, float* scale);
+
+// As caffe_cpu_quantize_rows but quantizes each column of X, stored as the
+// rows of q (cols x rows) so it can be the B argument of caffe_cpu_gemm_int8.
+template <typename Dtype>
+void caffe_cpu_quantize_cols(const int rows, const int cols, const Dtype* X,
+    int8_t* q, float* scale);
+
 template <typename Dtype>
 void caffe_axpy(const int N, const Dtype alpha, const Dtype* X,
     Dtype* Y);
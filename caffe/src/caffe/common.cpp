@@ -3,6 +3,9 @@
 #include <cmath>
 #include <cstdio>
 #include <ctime>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "caffe/common.hpp"
 #include "caffe/util/rng.hpp"
@@ -20,6 +23,15 @@ Caffe& Caffe::Get() {
   return *(thread_instance_.get());
 }
 
+int Caffe::cpu_threads() {
+#ifdef _OPENMP
+  int n = Get().cpu_threads_;
+  return n > 0 ? n : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
 // random seeding
 int64_t cluster_seedgen(void) {
   int64_t s, seed, pid;
@@ -53,7 +65,7 @@ void GlobalInit(int* pargc, char*** pargv) {
 #ifdef CPU_ONLY  // CPU-only Caffe.
 
 Caffe::Caffe()
-    : random_generator_(), mode_(Caffe::CPU),
+    : random_generator_(), mode_(Caffe::CPU), cpu_threads_(0),
       solver_count_(1), solver_rank_(0), multiprocess_(false) { }
 
 Caffe::~Caffe() { }
@@ -107,7 +119,7 @@ void* Caffe::RNG::generator() {
 
 Caffe::Caffe()
     : cublas_handle_(NULL), curand_generator_(NULL), random_generator_(),
-    mode_(Caffe::CPU),cudnn_enabled_(false),
+    mode_(Caffe::CPU),cudnn_enabled_(false), cpu_threads_(0),
     solver_count_(1), solver_rank_(0), multiprocess_(false) {
 
 #ifdef USE_CUDNN
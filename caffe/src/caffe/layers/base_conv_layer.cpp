@@ -13,6 +13,9 @@ void BaseConvolutionLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   // Configure the kernel size, padding, stride, and inputs.
   ConvolutionParameter conv_param = this->layer_param_.convolution_param();
   force_nd_im2col_ = conv_param.force_nd_im2col();
+  skip_zero_channels_ = conv_param.skip_zero_channels();
+  quantize_int8_ = conv_param.quantize_int8();
+  int8_weights_version_ = 0;
   channel_axis_ = bottom[0]->CanonicalAxisIndex(conv_param.axis());
   const int first_spatial_axis = channel_axis_ + 1;
   const int num_axes = bottom[0]->num_axes();
@@ -258,11 +261,20 @@ void BaseConvolutionLayer<Dtype>::forward_cpu_gemm(const Dtype* input,
     const Dtype* weights, Dtype* output, bool skip_im2col) {
   const Dtype* col_buff = input;
   if (!is_1x1_) {
+    if (skip_zero_channels_ && !skip_im2col &&
+        forward_cpu_sparse_gemm(input, weights, output)) {
+      return;
+    }
     if (!skip_im2col) {
       conv_im2col_cpu(input, col_buffer_.mutable_cpu_data());
     }
     col_buff = col_buffer_.cpu_data();
   }
+  if (quantize_int8_ && group_ == 1 && !reverse_dimensions()) {
+    quantize_weights_int8();
+    forward_cpu_gemm_int8(kernel_dim_, &int8_weights_[0], col_buff, output);
+    return;
+  }
   for (int g = 0; g < group_; ++g) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, conv_out_channels_ /
         group_, conv_out_spatial_dim_, kernel_dim_,
@@ -271,6 +283,113 @@ void BaseConvolutionLayer<Dtype>::forward_cpu_gemm(const Dtype* input,
   }
 }
 
+template <typename Dtype>
+bool BaseConvolutionLayer<Dtype>::forward_cpu_sparse_gemm(const Dtype* input,
+    const Dtype* weights, Dtype* output) {
+  if (group_ != 1 || reverse_dimensions()) { return false; }
+  const int in_spatial_dim = bottom_dim_ / conv_in_channels_;
+  vector<int> active;
+  for (int c = 0; c < conv_in_channels_; ++c) {
+    const Dtype* channel = input + c * in_spatial_dim;
+    for (int i = 0; i < in_spatial_dim; ++i) {
+      if (channel[i] != 0) {
+        active.push_back(c);
+        break;
+      }
+    }
+  }
+  if (active.size() == static_cast<size_t>(conv_in_channels_)) {
+    return false;
+  }
+  const int num_active = active.size();
+  if (num_active == 0) {
+    caffe_set(conv_out_channels_ * conv_out_spatial_dim_, Dtype(0), output);
+    return true;
+  }
+
+  // unroll each active channel into consecutive rows of the column buffer
+  const int kernel_volume = kernel_dim_ / conv_in_channels_;
+  vector<int> im_shape(conv_input_shape_.cpu_data(),
+      conv_input_shape_.cpu_data() + num_spatial_axes_ + 1);
+  vector<int> col_shape(col_buffer_shape_);
+  im_shape[0] = 1;
+  col_shape[0] = kernel_volume;
+  Dtype* col_buff = col_buffer_.mutable_cpu_data();
+  for (int i = 0; i < num_active; ++i) {
+    const Dtype* channel = input + active[i] * in_spatial_dim;
+    Dtype* rows = col_buff + i * kernel_volume * conv_out_spatial_dim_;
+    if (!force_nd_im2col_ && num_spatial_axes_ == 2) {
+      im2col_cpu(channel, 1, im_shape[1], im_shape[2],
+          kernel_shape_.cpu_data()[0], kernel_shape_.cpu_data()[1],
+          pad_.cpu_data()[0], pad_.cpu_data()[1],
+          stride_.cpu_data()[0], stride_.cpu_data()[1],
+          dilation_.cpu_data()[0], dilation_.cpu_data()[1], rows);
+    } else {
+      im2col_nd_cpu(channel, num_spatial_axes_, &im_shape[0], &col_shape[0],
+          kernel_shape_.cpu_data(), pad_.cpu_data(), stride_.cpu_data(),
+          dilation_.cpu_data(), rows);
+    }
+  }
+
+  const int compact_dim = num_active * kernel_volume;
+  if (quantize_int8_) {
+    // gather the matching columns of the quantized weights, which keep the
+    // scales of the full rows
+    quantize_weights_int8();
+    int8_compact_.resize(conv_out_channels_ * compact_dim);
+    for (int o = 0; o < conv_out_channels_; ++o) {
+      for (int i = 0; i < num_active; ++i) {
+        const int8_t* src = &int8_weights_[o * kernel_dim_ +
+            active[i] * kernel_volume];
+        std::copy(src, src + kernel_volume,
+            &int8_compact_[o * compact_dim + i * kernel_volume]);
+      }
+    }
+    forward_cpu_gemm_int8(compact_dim, &int8_compact_[0], col_buff, output);
+    return true;
+  }
+
+  // gather the matching columns of the weight matrix
+  compact_weights_.Reshape(vector<int>(1, conv_out_channels_ * compact_dim));
+  Dtype* compact = compact_weights_.mutable_cpu_data();
+  for (int o = 0; o < conv_out_channels_; ++o) {
+    for (int i = 0; i < num_active; ++i) {
+      const Dtype* src = weights + o * kernel_dim_ + active[i] * kernel_volume;
+      std::copy(src, src + kernel_volume,
+          compact + o * compact_dim + i * kernel_volume);
+    }
+  }
+  caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, conv_out_channels_,
+      conv_out_spatial_dim_, compact_dim, (Dtype)1., compact, col_buff,
+      (Dtype)0., output);
+  return true;
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::quantize_weights_int8() {
+  // one scale per output channel; the weights only change when training or
+  // when they are loaded or folded, so this is normally done once
+  const SyncedMemory& mem = *this->blobs_[0]->data();
+  if (mem.version() == int8_weights_version_) { return; }
+  int8_weights_.resize(conv_out_channels_ * kernel_dim_);
+  weight_scales_.resize(conv_out_channels_);
+  caffe_cpu_quantize_rows(conv_out_channels_, kernel_dim_,
+      this->blobs_[0]->cpu_data(), &int8_weights_[0], &weight_scales_[0]);
+  int8_weights_version_ = mem.version();
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::forward_cpu_gemm_int8(const int K,
+    const int8_t* weights, const Dtype* col_buff, Dtype* output) {
+  // activations get one scale per output location
+  int8_cols_.resize(K * conv_out_spatial_dim_);
+  col_scales_.resize(conv_out_spatial_dim_);
+  caffe_cpu_quantize_cols(K, conv_out_spatial_dim_, col_buff, &int8_cols_[0],
+      &col_scales_[0]);
+  caffe_cpu_gemm_int8(conv_out_channels_, conv_out_spatial_dim_, K,
+      weights, &weight_scales_[0], &int8_cols_[0], &col_scales_[0], output);
+}
+
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::forward_cpu_bias(Dtype* output,
     const Dtype* bias) {
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cfloat>
 #include <vector>
 
@@ -6,6 +7,10 @@
 
 namespace caffe {
 
+// elements per work item when combining inputs in parallel; small enough
+// that a block of every input stays in cache
+static const int kBlockSize = 4096;
+
 template <typename Dtype>
 void EltwiseLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
@@ -51,46 +56,68 @@ void EltwiseLayer<Dtype>::Forward_cpu(
   const Dtype* bottom_data_b = NULL;
   const int count = top[0]->count();
   Dtype* top_data = top[0]->mutable_cpu_data();
+  const int nbottom = bottom.size();
+  vector<const Dtype*> bottom_datas(nbottom);
+  for (int i = 0; i < nbottom; ++i) {
+    bottom_datas[i] = bottom[i]->cpu_data();
+  }
+  const int nthreads = Caffe::cpu_threads();
   switch (op_) {
   case EltwiseParameter_EltwiseOp_PROD:
-    caffe_mul(count, bottom[0]->cpu_data(), bottom[1]->cpu_data(), top_data);
-    for (int i = 2; i < bottom.size(); ++i) {
-      caffe_mul(count, top_data, bottom[i]->cpu_data(), top_data);
+    // each thread combines all the inputs over one block of the output
+#pragma omp parallel for num_threads(nthreads)
+    for (int start = 0; start < count; start += kBlockSize) {
+      const int end = std::min(start + kBlockSize, count);
+      caffe_mul(end - start, bottom_datas[0] + start, bottom_datas[1] + start,
+          top_data + start);
+      for (int i = 2; i < nbottom; ++i) {
+        caffe_mul(end - start, top_data + start, bottom_datas[i] + start,
+            top_data + start);
+      }
     }
     break;
   case EltwiseParameter_EltwiseOp_SUM:
-    caffe_set(count, Dtype(0), top_data);
-    // TODO(shelhamer) does BLAS optimize to sum for coeff = 1?
-    for (int i = 0; i < bottom.size(); ++i) {
-      caffe_axpy(count, coeffs_[i], bottom[i]->cpu_data(), top_data);
+#pragma omp parallel for num_threads(nthreads)
+    for (int start = 0; start < count; start += kBlockSize) {
+      const int end = std::min(start + kBlockSize, count);
+      const Dtype coeff = coeffs_[0];
+      const Dtype* bottom_data = bottom_datas[0];
+#pragma omp simd
+      for (int idx = start; idx < end; ++idx) {
+        top_data[idx] = coeff * bottom_data[idx];
+      }
+      for (int i = 1; i < nbottom; ++i) {
+        const Dtype coeff = coeffs_[i];
+        const Dtype* bottom_data = bottom_datas[i];
+#pragma omp simd
+        for (int idx = start; idx < end; ++idx) {
+          top_data[idx] += coeff * bottom_data[idx];
+        }
+      }
     }
     break;
   case EltwiseParameter_EltwiseOp_MAX:
-    // Initialize
     mask = max_idx_.mutable_cpu_data();
-    caffe_set(count, -1, mask);
-    caffe_set(count, Dtype(-FLT_MAX), top_data);
-    // bottom 0 & 1
-    bottom_data_a = bottom[0]->cpu_data();
-    bottom_data_b = bottom[1]->cpu_data();
+    bottom_data_a = bottom_datas[0];
+    bottom_data_b = bottom_datas[1];
+#pragma omp parallel for num_threads(nthreads)
     for (int idx = 0; idx < count; ++idx) {
+      // bottom 0 & 1
+      Dtype maxval = bottom_data_b[idx];
+      int maxid = 1;
       if (bottom_data_a[idx] > bottom_data_b[idx]) {
-        top_data[idx] = bottom_data_a[idx];  // maxval
-        mask[idx] = 0;  // maxid
-      } else {
-        top_data[idx] = bottom_data_b[idx];  // maxval
-        mask[idx] = 1;  // maxid
+        maxval = bottom_data_a[idx];
+        maxid = 0;
       }
-    }
-    // bottom 2++
-    for (int blob_idx = 2; blob_idx < bottom.size(); ++blob_idx) {
-      bottom_data_b = bottom[blob_idx]->cpu_data();
-      for (int idx = 0; idx < count; ++idx) {
-        if (bottom_data_b[idx] > top_data[idx]) {
-          top_data[idx] = bottom_data_b[idx];  // maxval
-          mask[idx] = blob_idx;  // maxid
+      // bottom 2++
+      for (int blob_idx = 2; blob_idx < nbottom; ++blob_idx) {
+        if (bottom_datas[blob_idx][idx] > maxval) {
+          maxval = bottom_datas[blob_idx][idx];
+          maxid = blob_idx;
         }
       }
+      top_data[idx] = maxval;
+      mask[idx] = maxid;
     }
     break;
   default:
@@ -137,6 +164,7 @@ void EltwiseLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
         break;
       case EltwiseParameter_EltwiseOp_MAX:
         mask = max_idx_.cpu_data();
+#pragma omp parallel for simd num_threads(Caffe::cpu_threads())
         for (int index = 0; index < count; ++index) {
           Dtype gradient = 0;
           if (mask[index] == i) {
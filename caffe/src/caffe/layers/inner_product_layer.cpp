@@ -12,6 +12,8 @@ void InnerProductLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   const int num_output = this->layer_param_.inner_product_param().num_output();
   bias_term_ = this->layer_param_.inner_product_param().bias_term();
   transpose_ = this->layer_param_.inner_product_param().transpose();
+  quantize_int8_ = this->layer_param_.inner_product_param().quantize_int8();
+  int8_weights_version_ = 0;
   N_ = num_output;
   const int axis = bottom[0]->CanonicalAxisIndex(
       this->layer_param_.inner_product_param().axis());
@@ -86,9 +88,32 @@ void InnerProductLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   const Dtype* bottom_data = bottom[0]->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
   const Dtype* weight = this->blobs_[0]->cpu_data();
-  caffe_cpu_gemm<Dtype>(CblasNoTrans, transpose_ ? CblasNoTrans : CblasTrans,
-      M_, N_, K_, (Dtype)1.,
-      bottom_data, weight, (Dtype)0., top_data);
+  if (quantize_int8_) {
+    int8_bottom_.resize(M_ * K_);
+    bottom_scales_.resize(M_);
+    caffe_cpu_quantize_rows(M_, K_, bottom_data, &int8_bottom_[0],
+        &bottom_scales_[0]);
+    // the weights are only requantized when they have changed
+    const unsigned long version = this->blobs_[0]->data()->version();
+    if (version != int8_weights_version_) {
+      int8_weights_.resize(N_ * K_);
+      weight_scales_.resize(N_);
+      if (transpose_) {
+        caffe_cpu_quantize_cols(K_, N_, weight, &int8_weights_[0],
+            &weight_scales_[0]);
+      } else {
+        caffe_cpu_quantize_rows(N_, K_, weight, &int8_weights_[0],
+            &weight_scales_[0]);
+      }
+      int8_weights_version_ = version;
+    }
+    caffe_cpu_gemm_int8(M_, N_, K_, &int8_bottom_[0], &bottom_scales_[0],
+        &int8_weights_[0], &weight_scales_[0], top_data);
+  } else {
+    caffe_cpu_gemm<Dtype>(CblasNoTrans, transpose_ ? CblasNoTrans : CblasTrans,
+        M_, N_, K_, (Dtype)1.,
+        bottom_data, weight, (Dtype)0., top_data);
+  }
   if (bias_term_) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, 1, (Dtype)1.,
         bias_multiplier_.cpu_data(),
@@ -240,6 +240,10 @@ void PoolingLayer<Dtype>::Forward_cpu(
   const int* stride_data = this->stride_.cpu_data();
   const int* input_shape_data = this->input_shape_.cpu_data();
   const int* output_shape_data = this->output_shape_.cpu_data();
+  // each (num, channel) slice is pooled independently, so slices are
+  // split between threads
+  const int bottom_step = bottom[0]->offset(offset);
+  const int top_step = top[0]->offset(offset);
 
   // Different pooling methods. We explicitly do the switch outside the for
   // loop to save time, although this results in more code.
@@ -256,60 +260,63 @@ void PoolingLayer<Dtype>::Forward_cpu(
     caffe_set(top_count, Dtype(-FLT_MAX), top_data);
     // The main loop
 
-    for (int n = 0; n < num_; ++n) {
-      for (int c = 0; c < channels_; ++c) {
-        if (num_spatial_axes_ == 2) {
-          for (int ph = 0; ph < output_shape_data[0]; ++ph) {
-            for (int pw = 0; pw < output_shape_data[1]; ++pw) {
+#pragma omp parallel for num_threads(Caffe::cpu_threads())
+    for (int nc = 0; nc < num_ * channels_; ++nc) {
+      const Dtype* bottom_slice = bottom_data + nc * bottom_step;
+      Dtype* top_slice = top_data + nc * top_step;
+      Dtype* top_mask_slice = use_top_mask ? top_mask + nc * top_step : NULL;
+      int* mask_slice = use_top_mask ? NULL : mask + nc * top_step;
+      if (num_spatial_axes_ == 2) {
+        for (int ph = 0; ph < output_shape_data[0]; ++ph) {
+          for (int pw = 0; pw < output_shape_data[1]; ++pw) {
+            int hstart = ph * stride_data[0] - pad_data[0];
+            int wstart = pw * stride_data[1] - pad_data[1];
+            int hend = min(hstart + kernel_shape[0], input_shape_data[1]);
+            int wend = min(wstart + kernel_shape[1], input_shape_data[2]);
+            hstart = max(hstart, 0);
+            wstart = max(wstart, 0);
+            const int pool_index = ph * output_shape_data[1] + pw;
+            for (int h = hstart; h < hend; ++h) {
+              for (int w = wstart; w < wend; ++w) {
+                const int index = h * input_shape_data[2] + w;
+                if (bottom_slice[index] > top_slice[pool_index]) {
+                  top_slice[pool_index] = bottom_slice[index];
+                  if (use_top_mask) {
+                    top_mask_slice[pool_index] = static_cast<Dtype>(index);
+                  } else {
+                    mask_slice[pool_index] = index;
+                  }
+                }
+              }
+            }
+          }
+        }
+      } else if (num_spatial_axes_ == 3) {
+        for (int ph = 0; ph < output_shape_data[0]; ++ph) {
+          for (int pw = 0; pw < output_shape_data[1]; ++pw) {
+            for (int pz = 0; pz< output_shape_data[2]; ++pz) {
               int hstart = ph * stride_data[0] - pad_data[0];
               int wstart = pw * stride_data[1] - pad_data[1];
+              int zstart = pz * stride_data[2] - pad_data[2];
               int hend = min(hstart + kernel_shape[0], input_shape_data[1]);
               int wend = min(wstart + kernel_shape[1], input_shape_data[2]);
+              int zend = min(zstart + kernel_shape[2], input_shape_data[3]);
               hstart = max(hstart, 0);
               wstart = max(wstart, 0);
-              const int pool_index = ph * output_shape_data[1] + pw;
+              zstart = max(zstart, 0);
+              const int pool_index = (ph * output_shape_data[1] + pw)*
+                                                output_shape_data[2] +pz;
               for (int h = hstart; h < hend; ++h) {
                 for (int w = wstart; w < wend; ++w) {
-                  const int index = h * input_shape_data[2] + w;
-                  if (bottom_data[index] > top_data[pool_index]) {
-                    top_data[pool_index] = bottom_data[index];
-                    if (use_top_mask) {
-                      top_mask[pool_index] = static_cast<Dtype>(index);
-                    } else {
-                      mask[pool_index] = index;
-                    }
-                  }
-                }
-              }
-            }
-          }
-        } else if (num_spatial_axes_ == 3) {
-          for (int ph = 0; ph < output_shape_data[0]; ++ph) {
-            for (int pw = 0; pw < output_shape_data[1]; ++pw) {
-              for (int pz = 0; pz< output_shape_data[2]; ++pz) {
-                int hstart = ph * stride_data[0] - pad_data[0];
-                int wstart = pw * stride_data[1] - pad_data[1];
-                int zstart = pz * stride_data[2] - pad_data[2];
-                int hend = min(hstart + kernel_shape[0], input_shape_data[1]);
-                int wend = min(wstart + kernel_shape[1], input_shape_data[2]);
-                int zend = min(zstart + kernel_shape[2], input_shape_data[3]);
-                hstart = max(hstart, 0);
-                wstart = max(wstart, 0);
-                zstart = max(zstart, 0);
-                const int pool_index = (ph * output_shape_data[1] + pw)*
-                                                  output_shape_data[2] +pz;
-                for (int h = hstart; h < hend; ++h) {
-                  for (int w = wstart; w < wend; ++w) {
-                    for (int z = zstart; z < zend; ++z) {
-                      const int index = (h * input_shape_data[2] + w)*
-                                                    input_shape_data[3]+z;
-                      if (bottom_data[index] > top_data[pool_index]) {
-                        top_data[pool_index] = bottom_data[index];
-                        if (use_top_mask) {
-                          top_mask[pool_index] = static_cast<Dtype>(index);
-                        } else {
-                          mask[pool_index] = index;
-                        }
+                  for (int z = zstart; z < zend; ++z) {
+                    const int index = (h * input_shape_data[2] + w)*
+                                                  input_shape_data[3]+z;
+                    if (bottom_slice[index] > top_slice[pool_index]) {
+                      top_slice[pool_index] = bottom_slice[index];
+                      if (use_top_mask) {
+                        top_mask_slice[pool_index] = static_cast<Dtype>(index);
+                      } else {
+                        mask_slice[pool_index] = index;
                       }
                     }
                   }
@@ -317,19 +324,9 @@ void PoolingLayer<Dtype>::Forward_cpu(
               }
             }
           }
-        } else {
-          NOT_IMPLEMENTED;
-        }
-        // compute offset
-        if (num_ > 1 || channels_ > 1) {
-          bottom_data += bottom[0]->offset(offset);
-          top_data += top[0]->offset(offset);
-          if (use_top_mask) {
-            top_mask += top[0]->offset(offset);
-          } else {
-            mask += top[0]->offset(offset);
-          }
         }
+      } else {
+        NOT_IMPLEMENTED;
       }
     }
     break;
@@ -339,78 +336,74 @@ void PoolingLayer<Dtype>::Forward_cpu(
     }
     // The main loop
     // printf ("Num axes: %d\n",num_spatial_axes_);
-    for (int n = 0; n < num_; ++n) {
-      for (int c = 0; c < channels_; ++c) {
-          if (num_spatial_axes_ == 2) {
-            for (int ph = 0; ph < output_shape_data[0]; ++ph) {
-              for (int pw = 0; pw < output_shape_data[1]; ++pw) {
+#pragma omp parallel for num_threads(Caffe::cpu_threads())
+    for (int nc = 0; nc < num_ * channels_; ++nc) {
+      const Dtype* bottom_slice = bottom_data + nc * bottom_step;
+      Dtype* top_slice = top_data + nc * top_step;
+        if (num_spatial_axes_ == 2) {
+          for (int ph = 0; ph < output_shape_data[0]; ++ph) {
+            for (int pw = 0; pw < output_shape_data[1]; ++pw) {
+              int hstart = ph * stride_data[0] - pad_data[0];
+              int wstart = pw * stride_data[1] - pad_data[1];
+              int hend = min(hstart + kernel_shape[0],
+                       input_shape_data[1] + pad_data[0]);
+              int wend = min(wstart + kernel_shape[1],
+                       input_shape_data[2] + pad_data[1]);
+              int pool_size = (hend - hstart) * (wend - wstart);
+              hstart = max(hstart, 0);
+              wstart = max(wstart, 0);
+              hend = min(hend, input_shape_data[1]);
+              wend = min(wend, input_shape_data[2]);
+              const int pool_index = ph * output_shape_data[1] + pw;
+              for (int h = hstart; h < hend; ++h) {
+                for (int w = wstart; w < wend; ++w) {
+                  const int index = h * input_shape_data[2] + w;
+                  top_slice[pool_index] += bottom_slice[index];
+                }
+              }
+              top_slice[pool_index] /= pool_size;
+            }
+          }
+      } else if (num_spatial_axes_ == 3) {
+          for (int ph = 0; ph < output_shape_data[0]; ++ph) {
+            for (int pw = 0; pw < output_shape_data[1]; ++pw) {
+              for (int pz = 0; pz< output_shape_data[2]; ++pz) {
                 int hstart = ph * stride_data[0] - pad_data[0];
                 int wstart = pw * stride_data[1] - pad_data[1];
+                int zstart = pz * stride_data[2] - pad_data[2];
                 int hend = min(hstart + kernel_shape[0],
-                         input_shape_data[1] + pad_data[0]);
+                          input_shape_data[1]+ pad_data[0]);
                 int wend = min(wstart + kernel_shape[1],
-                         input_shape_data[2] + pad_data[1]);
-                int pool_size = (hend - hstart) * (wend - wstart);
+                        input_shape_data[2]+ pad_data[1]);
+                int zend = min(zstart + kernel_shape[2],
+                         input_shape_data[3]+ pad_data[2]);
+                int pool_size = (hend - hstart) *
+                                (wend - wstart) *
+                                (zend - zstart);
                 hstart = max(hstart, 0);
                 wstart = max(wstart, 0);
+                zstart = max(zstart, 0);
                 hend = min(hend, input_shape_data[1]);
                 wend = min(wend, input_shape_data[2]);
-                const int pool_index = ph * output_shape_data[1] + pw;
+                zend = min(zend, input_shape_data[3]);
+
+                const int pool_index = (ph * output_shape_data[1] + pw)*
+                                                output_shape_data[2] +pz;
                 for (int h = hstart; h < hend; ++h) {
                   for (int w = wstart; w < wend; ++w) {
-                    const int index = h * input_shape_data[2] + w;
-                    top_data[pool_index] += bottom_data[index];
-                  }
-                }
-                top_data[pool_index] /= pool_size;
-              }
-            }
-        } else if (num_spatial_axes_ == 3) {
-            for (int ph = 0; ph < output_shape_data[0]; ++ph) {
-              for (int pw = 0; pw < output_shape_data[1]; ++pw) {
-                for (int pz = 0; pz< output_shape_data[2]; ++pz) {
-                  int hstart = ph * stride_data[0] - pad_data[0];
-                  int wstart = pw * stride_data[1] - pad_data[1];
-                  int zstart = pz * stride_data[2] - pad_data[2];
-                  int hend = min(hstart + kernel_shape[0],
-                            input_shape_data[1]+ pad_data[0]);
-                  int wend = min(wstart + kernel_shape[1],
-                          input_shape_data[2]+ pad_data[1]);
-                  int zend = min(zstart + kernel_shape[2],
-                           input_shape_data[3]+ pad_data[2]);
-                  int pool_size = (hend - hstart) *
-                                  (wend - wstart) *
-                                  (zend - zstart);
-                  hstart = max(hstart, 0);
-                  wstart = max(wstart, 0);
-                  zstart = max(zstart, 0);
-                  hend = min(hend, input_shape_data[1]);
-                  wend = min(wend, input_shape_data[2]);
-                  zend = min(zend, input_shape_data[3]);
-
-                  const int pool_index = (ph * output_shape_data[1] + pw)*
-                                                  output_shape_data[2] +pz;
-                  for (int h = hstart; h < hend; ++h) {
-                    for (int w = wstart; w < wend; ++w) {
-                      for (int z = zstart; z < zend; ++z) {
-                        const int index = (h * input_shape_data[2] + w)*
-                                                      input_shape_data[3]+z;
-                        top_data[pool_index] += bottom_data[index];
-                      }
+                    for (int z = zstart; z < zend; ++z) {
+                      const int index = (h * input_shape_data[2] + w)*
+                                                    input_shape_data[3]+z;
+                      top_slice[pool_index] += bottom_slice[index];
                     }
                   }
-                  top_data[pool_index] /= pool_size;
                 }
+                top_slice[pool_index] /= pool_size;
               }
             }
-        } else {
-          NOT_IMPLEMENTED;
-        }
-        // compute offset
-        if (num_ > 1 || channels_ > 1) {
-          bottom_data += bottom[0]->offset(offset);
-          top_data += top[0]->offset(offset);
-        }
+          }
+      } else {
+        NOT_IMPLEMENTED;
       }
     }
     break;
@@ -446,6 +439,8 @@ void PoolingLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
   int top_num = top[0]->count(0, channel_axis_);
   vector<int> offset(2, 0);
   offset[1] = 1;
+  const int bottom_step = bottom[0]->offset(offset);
+  const int top_step = top[0]->offset(offset);
   switch (this->layer_param_.pooling_param().pool()) {
   case PoolingParameter_PoolMethod_MAX:
     // The main loop
@@ -454,41 +449,37 @@ void PoolingLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     } else {
       mask = max_idx_.cpu_data();
     }
-    for (int n = 0; n < top_num; ++n) {
-      for (int c = 0; c < channels_; ++c) {
-        if (num_spatial_axes_ == 2) {
-          for (int ph = 0; ph < output_shape_data[0]; ++ph) {
-            for (int pw = 0; pw < output_shape_data[1]; ++pw) {
-              const int index = ph * output_shape_data[1] + pw;
-              const int bottom_index =
-                  use_top_mask ? top_mask[index] : mask[index];
-              bottom_diff[bottom_index] += top_diff[index];
-            }
-          }
-        } else if (num_spatial_axes_ == 3) {
-            for (int ph = 0; ph < output_shape_data[0]; ++ph) {
-              for (int pw = 0; pw < output_shape_data[1]; ++pw) {
-                for (int pz = 0; pz < output_shape_data[2]; ++pz) {
-                const int index = (ph * output_shape_data[1] + pw)*
-                                            output_shape_data[2] +pz;
-                const int bottom_index =
-                    use_top_mask ? top_mask[index] : mask[index];
-                bottom_diff[bottom_index] += top_diff[index];
-              }
-            }
+    // slices only scatter into their own part of bottom_diff
+#pragma omp parallel for num_threads(Caffe::cpu_threads())
+    for (int nc = 0; nc < top_num * channels_; ++nc) {
+      Dtype* bottom_slice = bottom_diff + nc * bottom_step;
+      const Dtype* top_slice = top_diff + nc * top_step;
+      const Dtype* top_mask_slice =
+          use_top_mask ? top_mask + nc * top_step : NULL;
+      const int* mask_slice = use_top_mask ? NULL : mask + nc * top_step;
+      if (num_spatial_axes_ == 2) {
+        for (int ph = 0; ph < output_shape_data[0]; ++ph) {
+          for (int pw = 0; pw < output_shape_data[1]; ++pw) {
+            const int index = ph * output_shape_data[1] + pw;
+            const int bottom_index =
+                use_top_mask ? top_mask_slice[index] : mask_slice[index];
+            bottom_slice[bottom_index] += top_slice[index];
           }
-        } else {
-          NOT_IMPLEMENTED;
         }
-        if (num_ > 1 || channels_ > 1) {
-          bottom_diff += bottom[0]->offset(offset);
-          top_diff += top[0]->offset(offset);
-          if (use_top_mask) {
-            top_mask += top[0]->offset(offset);
-          } else {
-            mask += top[0]->offset(offset);
+      } else if (num_spatial_axes_ == 3) {
+        for (int ph = 0; ph < output_shape_data[0]; ++ph) {
+          for (int pw = 0; pw < output_shape_data[1]; ++pw) {
+            for (int pz = 0; pz < output_shape_data[2]; ++pz) {
+              const int index = (ph * output_shape_data[1] + pw)*
+                                          output_shape_data[2] +pz;
+              const int bottom_index =
+                  use_top_mask ? top_mask_slice[index] : mask_slice[index];
+              bottom_slice[bottom_index] += top_slice[index];
+            }
           }
         }
+      } else {
+        NOT_IMPLEMENTED;
       }
     }
     break;
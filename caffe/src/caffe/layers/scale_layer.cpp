@@ -128,12 +128,15 @@ void ScaleLayer<Dtype>::Forward_cpu(
   const Dtype* scale_data =
       ((bottom.size() > 1) ? bottom[1] : this->blobs_[0].get())->cpu_data();
   Dtype* top_data = top[0]->mutable_cpu_data();
-  for (int n = 0; n < outer_dim_; ++n) {
-    for (int d = 0; d < scale_dim_; ++d) {
-      const Dtype factor = scale_data[d];
-      caffe_cpu_scale(inner_dim_, factor, bottom_data, top_data);
-      bottom_data += inner_dim_;
-      top_data += inner_dim_;
+  const int slices = outer_dim_ * scale_dim_;
+#pragma omp parallel for num_threads(Caffe::cpu_threads())
+  for (int nd = 0; nd < slices; ++nd) {
+    const Dtype factor = scale_data[nd % scale_dim_];
+    const Dtype* bottom_slice = bottom_data + nd * inner_dim_;
+    Dtype* top_slice = top_data + nd * inner_dim_;
+#pragma omp simd
+    for (int i = 0; i < inner_dim_; ++i) {
+      top_slice[i] = factor * bottom_slice[i];
     }
   }
   if (bias_layer_) {
@@ -206,12 +209,15 @@ void ScaleLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     const Dtype* top_diff = top[0]->cpu_diff();
     const Dtype* scale_data = scale->cpu_data();
     Dtype* bottom_diff = bottom[0]->mutable_cpu_diff();
-    for (int n = 0; n < outer_dim_; ++n) {
-      for (int d = 0; d < scale_dim_; ++d) {
-        const Dtype factor = scale_data[d];
-        caffe_cpu_scale(inner_dim_, factor, top_diff, bottom_diff);
-        bottom_diff += inner_dim_;
-        top_diff += inner_dim_;
+    const int slices = outer_dim_ * scale_dim_;
+#pragma omp parallel for num_threads(Caffe::cpu_threads())
+    for (int nd = 0; nd < slices; ++nd) {
+      const Dtype factor = scale_data[nd % scale_dim_];
+      const Dtype* top_slice = top_diff + nd * inner_dim_;
+      Dtype* bottom_slice = bottom_diff + nd * inner_dim_;
+#pragma omp simd
+      for (int i = 0; i < inner_dim_; ++i) {
+        bottom_slice[i] = factor * top_slice[i];
       }
     }
   }
@@ -251,11 +251,175 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
   for (size_t layer_id = 0; layer_id < layer_names_.size(); ++layer_id) {
     layer_names_index_[layer_names_[layer_id]] = layer_id;
   }
+  PlanMemory(param);
   ShareWeights();
   debug_info_ = param.debug_info();
   LOG_IF(INFO, Caffe::root_solver()) << "Network initialization done.";
 }
 
+template <typename Dtype>
+void Net<Dtype>::PlanMemory(const NetParameter& param) {
+  if (param.memory_plan() == NetParameter_MemoryPlan_NO_SHARING) {
+    return;
+  }
+  // A blob is live from the first layer that uses it to the last, in either
+  // direction.  Blobs whose lifetimes do not overlap can share memory.
+  const int num_blobs = blobs_.size();
+  vector<int> first_use(num_blobs, layers_.size());
+  vector<int> last_use(num_blobs, -1);
+  vector<int> num_readers(num_blobs, 0);
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    for (int i = 0; i < bottom_id_vecs_[layer_id].size(); ++i) {
+      const int blob_id = bottom_id_vecs_[layer_id][i];
+      first_use[blob_id] = std::min(first_use[blob_id], layer_id);
+      last_use[blob_id] = std::max(last_use[blob_id], layer_id);
+      num_readers[blob_id]++;
+    }
+    for (int i = 0; i < top_id_vecs_[layer_id].size(); ++i) {
+      const int blob_id = top_id_vecs_[layer_id][i];
+      first_use[blob_id] = std::min(first_use[blob_id], layer_id);
+      last_use[blob_id] = std::max(last_use[blob_id], layer_id);
+    }
+  }
+  // Inputs and outputs are read and written by the caller and the diff of a
+  // loss top holds its loss weight, so these keep their own memory.
+  vector<bool> fixed(num_blobs, false);
+  for (int i = 0; i < net_input_blob_indices_.size(); ++i) {
+    fixed[net_input_blob_indices_[i]] = true;
+  }
+  for (int i = 0; i < net_output_blob_indices_.size(); ++i) {
+    fixed[net_output_blob_indices_[i]] = true;
+  }
+  for (int blob_id = 0; blob_id < blob_loss_weights_.size(); ++blob_id) {
+    if (blob_loss_weights_[blob_id] != 0) {
+      fixed[blob_id] = true;
+    }
+  }
+  for (int i = 0; i < param.keep_blob_size(); ++i) {
+    CHECK(has_blob(param.keep_blob(i))) << "Unknown keep_blob "
+        << param.keep_blob(i);
+    fixed[blob_names_index_[param.keep_blob(i)]] = true;
+  }
+  size_t saved = 0;
+  if (param.memory_plan() == NetParameter_MemoryPlan_SHARE_ALL) {
+    saved += ShareBlobMemory(first_use, last_use, fixed, false);
+  }
+  // A diff can only be shared if every layer reading the blob overwrites its
+  // diff in Backward; otherwise the producer would see another blob's diff.
+  vector<bool> fixed_diff(fixed);
+  for (int blob_id = 0; blob_id < num_blobs; ++blob_id) {
+    if (!blob_need_backward_[blob_id] || num_readers[blob_id] == 0) {
+      fixed_diff[blob_id] = true;
+    }
+  }
+  for (int layer_id = 0; layer_id < layers_.size(); ++layer_id) {
+    for (int i = 0; i < bottom_id_vecs_[layer_id].size(); ++i) {
+      if (!bottom_need_backward_[layer_id][i]) {
+        fixed_diff[bottom_id_vecs_[layer_id][i]] = true;
+      }
+    }
+  }
+  saved += ShareBlobMemory(first_use, last_use, fixed_diff, true);
+  LOG_IF(INFO, Caffe::root_solver())
+      << "Memory saved by sharing blobs: " << saved;
+}
+
+template <typename Dtype>
+size_t Net<Dtype>::ShareBlobMemory(const vector<int>& first_use,
+    const vector<int>& last_use, const vector<bool>& fixed, bool diff) {
+  // Blobs that already share memory (e.g. split tops, in-place flattens) are
+  // placed together.  If something other than the net's blobs holds that
+  // memory (e.g. a layer's internal buffer) the group is left alone.
+  map<SyncedMemory*, int> group_index;
+  vector<vector<int> > groups;
+  for (int blob_id = 0; blob_id < blobs_.size(); ++blob_id) {
+    if (blobs_[blob_id]->count() == 0) {
+      continue;
+    }
+    SyncedMemory* memory = diff ? blobs_[blob_id]->diff().get() :
+        blobs_[blob_id]->data().get();
+    if (group_index.find(memory) == group_index.end()) {
+      group_index[memory] = groups.size();
+      groups.push_back(vector<int>());
+    }
+    groups[group_index[memory]].push_back(blob_id);
+  }
+  vector<int> group_first(groups.size()), group_last(groups.size());
+  vector<size_t> group_bytes(groups.size(), 0);
+  vector<pair<int, int> > order;  // (first use, group)
+  for (int g = 0; g < groups.size(); ++g) {
+    const vector<int>& group = groups[g];
+    const shared_ptr<SyncedMemory>& memory = diff ?
+        blobs_[group[0]]->diff() : blobs_[group[0]]->data();
+    bool shareable = memory.use_count() == group.size();
+    group_first[g] = first_use[group[0]];
+    group_last[g] = last_use[group[0]];
+    for (int i = 0; i < group.size(); ++i) {
+      shareable = shareable && !fixed[group[i]];
+      group_first[g] = std::min(group_first[g], first_use[group[i]]);
+      group_last[g] = std::max(group_last[g], last_use[group[i]]);
+      group_bytes[g] = std::max(group_bytes[g],
+          blobs_[group[i]]->count() * sizeof(Dtype));
+    }
+    if (shareable) {
+      order.push_back(std::make_pair(group_first[g], g));
+    }
+  }
+  std::sort(order.begin(), order.end());
+  // Greedily place each group, in order of first use, in the smallest free
+  // buffer that holds it, else grow the largest free buffer.
+  vector<size_t> buffer_bytes;
+  vector<int> buffer_free_after;
+  vector<int> group_buffer(groups.size(), -1);
+  size_t unshared = 0;
+  for (int i = 0; i < order.size(); ++i) {
+    const int g = order[i].second;
+    int best = -1;
+    for (int b = 0; b < buffer_bytes.size(); ++b) {
+      if (buffer_free_after[b] >= group_first[g]) {
+        continue;
+      }
+      if (best < 0) {
+        best = b;
+      } else if (buffer_bytes[b] >= group_bytes[g]) {
+        if (buffer_bytes[best] < group_bytes[g] ||
+            buffer_bytes[b] < buffer_bytes[best]) {
+          best = b;
+        }
+      } else if (buffer_bytes[b] > buffer_bytes[best]) {
+        best = b;
+      }
+    }
+    if (best < 0) {
+      best = buffer_bytes.size();
+      buffer_bytes.push_back(0);
+      buffer_free_after.push_back(-1);
+    }
+    buffer_bytes[best] = std::max(buffer_bytes[best], group_bytes[g]);
+    buffer_free_after[best] = group_last[g];
+    group_buffer[g] = best;
+    unshared += group_bytes[g];
+  }
+  vector<shared_ptr<SyncedMemory> > buffers(buffer_bytes.size());
+  size_t shared = 0;
+  for (int b = 0; b < buffers.size(); ++b) {
+    buffers[b].reset(new SyncedMemory(buffer_bytes[b]));
+    shared += buffer_bytes[b];
+  }
+  for (int i = 0; i < order.size(); ++i) {
+    const int g = order[i].second;
+    for (int j = 0; j < groups[g].size(); ++j) {
+      Blob<Dtype>* blob = blobs_[groups[g][j]].get();
+      if (diff) {
+        blob->UseDiffMemory(buffers[group_buffer[g]]);
+      } else {
+        blob->UseDataMemory(buffers[group_buffer[g]]);
+      }
+    }
+  }
+  return unshared - shared;
+}
+
 template <typename Dtype>
 void Net<Dtype>::FilterNet(const NetParameter& param,
     NetParameter* param_filtered) {
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -495,6 +497,77 @@ TYPED_TEST(ConvolutionLayerTest, TestSimpleConvolutionGroup) {
   }
 }
 
+// int8 products are only accurate to a few percent of the output range
+template <typename Dtype>
+static void expect_near_int8(const Blob<Dtype>& top, const Blob<Dtype>& ref) {
+  const Dtype* top_data = top.cpu_data();
+  const Dtype* ref_top_data = ref.cpu_data();
+  Dtype maxabs = 0;
+  for (int i = 0; i < ref.count(); ++i) {
+    maxabs = std::max(maxabs, std::fabs(ref_top_data[i]));
+  }
+  for (int i = 0; i < top.count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 0.1 * maxabs);
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestInt8Convolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_stride(1);
+  convolution_param->set_num_output(4);
+  convolution_param->set_quantize_int8(true);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("constant");
+  convolution_param->mutable_bias_filler()->set_value(0.1);
+  shared_ptr<Layer<Dtype> > layer(
+      new ConvolutionLayer<Dtype>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  expect_near_int8(*this->blob_top_, *this->ref_blob_top_);
+  // the cached quantized weights must follow changes to the weights
+  Blob<Dtype>& weights = *layer->blobs()[0];
+  caffe_scal(weights.count(), Dtype(-2), weights.mutable_cpu_data());
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  expect_near_int8(*this->blob_top_, *this->ref_blob_top_);
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestInt8ConvolutionSkipZeroChannels) {
+  typedef typename TypeParam::Dtype Dtype;
+  // zero the middle channel so only the other two are multiplied
+  const int spatial_dim = this->blob_bottom_->count(2);
+  Dtype* bottom_data = this->blob_bottom_->mutable_cpu_data();
+  for (int n = 0; n < this->blob_bottom_->num(); ++n) {
+    caffe_set(spatial_dim, Dtype(0),
+        bottom_data + this->blob_bottom_->offset(n, 1));
+  }
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_stride(1);
+  convolution_param->set_num_output(4);
+  convolution_param->set_quantize_int8(true);
+  convolution_param->set_skip_zero_channels(true);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("constant");
+  convolution_param->mutable_bias_filler()->set_value(0.1);
+  shared_ptr<Layer<Dtype> > layer(
+      new ConvolutionLayer<Dtype>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  expect_near_int8(*this->blob_top_, *this->ref_blob_top_);
+}
+
 TYPED_TEST(ConvolutionLayerTest, TestSobelConvolution) {
   // Test separable convolution by computing the Sobel operator
   // as a single filter then comparing the result
@@ -1,6 +1,7 @@
 #include <stdint.h>  // for uint32_t & uint64_t
 #include <time.h>
 #include <cmath>  // for std::fabs
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -119,6 +120,39 @@ TYPED_TEST(CPUMathFunctionsTest, TestCopy) {
   }
 }
 
+TYPED_TEST(CPUMathFunctionsTest, TestGemmInt8) {
+  // A (M x K) times B (K x N), with B quantized by columns
+  const int M = 7, N = 45, K = 29;
+  Blob<TypeParam> A(1, 1, M, K), B(1, 1, K, N), C(1, 1, M, N), ref(1, 1, M, N);
+  FillerParameter filler_param;
+  GaussianFiller<TypeParam> filler(filler_param);
+  filler.Fill(&A);
+  filler.Fill(&B);
+  const TypeParam* a = A.cpu_data();
+  const TypeParam* b = B.cpu_data();
+  vector<int8_t> qa(M * K), qb(N * K);
+  vector<float> sa(M), sb(N);
+  caffe_cpu_quantize_rows(M, K, a, &qa[0], &sa[0]);
+  caffe_cpu_quantize_cols(K, N, b, &qb[0], &sb[0]);
+  caffe_cpu_gemm_int8(M, N, K, &qa[0], &sa[0], &qb[0], &sb[0],
+      C.mutable_cpu_data());
+  caffe_cpu_gemm<TypeParam>(CblasNoTrans, CblasNoTrans, M, N, K, 1., a, b, 0.,
+      ref.mutable_cpu_data());
+  const TypeParam* c = C.cpu_data();
+  const TypeParam* r = ref.cpu_data();
+  for (int m = 0; m < M; ++m) {
+    for (int n = 0; n < N; ++n) {
+      // every quantized value is off by at most half its scale
+      TypeParam bound = 0;
+      for (int k = 0; k < K; ++k) {
+        bound += 0.5 * (std::fabs(a[m * K + k]) * sb[n] +
+            std::fabs(b[k * N + n]) * sa[m]) + 0.25 * sa[m] * sb[n];
+      }
+      EXPECT_NEAR(c[m * N + n], r[m * N + n], bound + 1e-4);
+    }
+  }
+}
+
 #ifndef CPU_ONLY
 
 template <typename Dtype>
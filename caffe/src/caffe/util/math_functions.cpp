@@ -1,6 +1,7 @@
 #include <boost/math/special_functions/next.hpp>
 #include <boost/random.hpp>
 
+#include <algorithm>
 #include <limits>
 
 #include "caffe/common.hpp"
@@ -79,6 +80,100 @@ template <>
 void caffe_axpy<double>(const int N, const double alpha, const double* X,
     double* Y) { cblas_daxpy(N, alpha, X, 1, Y, 1); }
 
+// rows of B handled together so they stay in cache while every row of A
+// is multiplied against them
+static const int kInt8BlockRows = 64;
+
+template <typename Dtype>
+void caffe_cpu_gemm_int8(const int M, const int N, const int K,
+    const int8_t* A, const float* a_scale, const int8_t* B,
+    const float* b_scale, Dtype* C) {
+#pragma omp parallel for num_threads(Caffe::cpu_threads())
+  for (int start = 0; start < N; start += kInt8BlockRows) {
+    const int end = std::min(start + kInt8BlockRows, N);
+    for (int m = 0; m < M; ++m) {
+      const int8_t* a = A + m * K;
+      for (int n = start; n < end; ++n) {
+        const int8_t* b = B + n * K;
+        int32_t sum = 0;
+#pragma omp simd reduction(+:sum)
+        for (int k = 0; k < K; ++k) {
+          sum += int16_t(a[k]) * int16_t(b[k]);
+        }
+        C[m * N + n] = Dtype(sum * a_scale[m] * b_scale[n]);
+      }
+    }
+  }
+}
+
+template void caffe_cpu_gemm_int8<float>(const int M, const int N,
+    const int K, const int8_t* A, const float* a_scale, const int8_t* B,
+    const float* b_scale, float* C);
+template void caffe_cpu_gemm_int8<double>(const int M, const int N,
+    const int K, const int8_t* A, const float* a_scale, const int8_t* B,
+    const float* b_scale, double* C);
+
+template <typename Dtype>
+static inline int8_t quantize_int8(const Dtype x, const float inv_scale) {
+  return static_cast<int8_t>(std::nearbyint(x * inv_scale));
+}
+
+template <typename Dtype>
+void caffe_cpu_quantize_rows(const int rows, const int cols, const Dtype* X,
+    int8_t* q, float* scale) {
+#pragma omp parallel for num_threads(Caffe::cpu_threads())
+  for (int r = 0; r < rows; ++r) {
+    const Dtype* x = X + r * cols;
+    Dtype maxabs = 0;
+    for (int c = 0; c < cols; ++c) {
+      maxabs = std::max(maxabs, std::fabs(x[c]));
+    }
+    scale[r] = maxabs / 127;
+    const float inv_scale = maxabs > 0 ? 127 / maxabs : 0;
+    for (int c = 0; c < cols; ++c) {
+      q[r * cols + c] = quantize_int8(x[c], inv_scale);
+    }
+  }
+}
+
+template void caffe_cpu_quantize_rows<float>(const int rows, const int cols,
+    const float* X, int8_t* q, float* scale);
+template void caffe_cpu_quantize_rows<double>(const int rows, const int cols,
+    const double* X, int8_t* q, float* scale);
+
+template <typename Dtype>
+void caffe_cpu_quantize_cols(const int rows, const int cols, const Dtype* X,
+    int8_t* q, float* scale) {
+  // work on blocks of columns so X is read along its rows
+#pragma omp parallel for num_threads(Caffe::cpu_threads())
+  for (int start = 0; start < cols; start += kInt8BlockRows) {
+    const int end = std::min(start + kInt8BlockRows, cols);
+    Dtype maxabs[kInt8BlockRows] = { 0 };
+    for (int r = 0; r < rows; ++r) {
+      for (int c = start; c < end; ++c) {
+        maxabs[c - start] = std::max(maxabs[c - start],
+            std::fabs(X[r * cols + c]));
+      }
+    }
+    float inv_scale[kInt8BlockRows];
+    for (int c = start; c < end; ++c) {
+      scale[c] = maxabs[c - start] / 127;
+      inv_scale[c - start] =
+          maxabs[c - start] > 0 ? 127 / maxabs[c - start] : 0;
+    }
+    for (int r = 0; r < rows; ++r) {
+      for (int c = start; c < end; ++c) {
+        q[c * rows + r] = quantize_int8(X[r * cols + c], inv_scale[c - start]);
+      }
+    }
+  }
+}
+
+template void caffe_cpu_quantize_cols<float>(const int rows, const int cols,
+    const float* X, int8_t* q, float* scale);
+template void caffe_cpu_quantize_cols<double>(const int rows, const int cols,
+    const double* X, int8_t* q, float* scale);
+
 template <typename Dtype>
 void caffe_set(const int N, const Dtype alpha, Dtype* Y) {
   if (alpha == 0) {
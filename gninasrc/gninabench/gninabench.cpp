@@ -0,0 +1,396 @@
+/*
+ * gninabench.cpp
+ *
+ * Benchmark the stages of docking on a fixed set of receptor/ligand pairs.
+ * Reports grid population time, Monte Carlo steps/sec, BFGS evaluations/sec,
+ * CNN forwards/sec and end-to-end ligands/hour (for each thread count) as
+ * JSON so performance can be compared between releases.  Ligands/hour is
+ * extrapolated from one timed docking of each target's own ligand, so it
+ * leaves out ligand reading and output and varies with the ligand's size.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <fstream>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/timer/timer.hpp>
+#include <openbabel/oberror.h>
+
+#include "molgetter.h"
+#include "box.h"
+#include "cache.h"
+#include "non_cache.h"
+#include "custom_terms.h"
+#include "builtinscoring.h"
+#include "weighted_terms.h"
+#include "precalculate.h"
+#include "quasi_newton.h"
+#include "monte_carlo.h"
+#include "parallel_mc.h"
+#include "cnn_scorer.h"
+#include "tee.h"
+
+#ifndef GNINA_BENCH_DATA
+#define GNINA_BENCH_DATA "test/gnina/data"
+#endif
+
+using namespace std;
+using namespace boost::filesystem;
+
+struct bench_options {
+    string data_dir;
+    vector<string> targets;
+    vector<int> threads;
+    string outname;
+    string cnn_model;
+    unsigned mc_steps;
+    unsigned minimizations;
+    unsigned cnn_evals;
+    int exhaustiveness;
+    int seed;
+    bool no_cnn;
+    bool gpu;
+    bool help;
+
+    bench_options()
+        : data_dir(GNINA_BENCH_DATA), cnn_model("crossdock_default2018"),
+            mc_steps(200), minimizations(50), cnn_evals(20), exhaustiveness(8),
+            seed(0), no_cnn(false), gpu(false), help(false) {
+    }
+};
+
+//counts evaluations of the wrapped grid
+struct counting_igrid : public igrid {
+    igrid& ig;
+    mutable std::atomic<unsigned long> evals;
+
+    counting_igrid(igrid& g)
+        : ig(g), evals(0) {
+    }
+    fl eval(const model& m, fl v) const {
+      evals++;
+      return ig.eval(m, v);
+    }
+    fl eval_deriv(model& m, fl v, const grid& user_grid) const {
+      evals++;
+      return ig.eval_deriv(m, v, user_grid);
+    }
+};
+
+//results for one receptor/ligand pair
+struct bench_result {
+    string target;
+    sz movable_atoms;
+    sz degrees_of_freedom;
+    double grid_seconds;
+    double mc_steps_per_sec;
+    double bfgs_evals_per_sec;
+    double cnn_forwards_per_sec;
+    double cnn_backwards_per_sec;
+    vector<pair<int, double> > ligands_per_hour; //threads, rate from docking this one ligand
+
+    bench_result()
+        : movable_atoms(0), degrees_of_freedom(0), grid_seconds(0),
+            mc_steps_per_sec(0), bfgs_evals_per_sec(0), cnn_forwards_per_sec(0),
+            cnn_backwards_per_sec(0) {
+    }
+};
+
+static double seconds(const boost::timer::cpu_timer& t) {
+  return t.elapsed().wall / 1000000000.0;
+}
+
+//ligand is either an sdf or a pdb file
+static string find_ligand(const string& dir, const string& target) {
+  const char *exts[] = { "_lig.sdf", "_lig.sdf.gz", "_lig.pdb" };
+  for (unsigned i = 0; i < 3; i++) {
+    path p = path(dir) / (target + exts[i]);
+    if (exists(p)) return p.string();
+  }
+  throw file_error(path(dir) / (target + "_lig.sdf"), true);
+}
+
+static bench_result run_target(const bench_options& o, const string& target,
+    const precalculate& prec) {
+  bench_result res;
+  res.target = target;
+  tee log(true);
+  FlexInfo finfo(log);
+  string recname = (path(o.data_dir) / (target + "_rec.pdb")).string();
+  string ligname = find_ligand(o.data_dir, target);
+
+  MolGetter mols(recname, "", finfo, true, true, log);
+  mols.setInputFile(ligname);
+  model m;
+  if (!mols.readMoleculeIntoModel(m))
+    throw usage_error("Could not read ligand " + ligname);
+  res.movable_atoms = m.num_movable_atoms();
+  res.degrees_of_freedom = m.get_size().num_degrees_of_freedom();
+
+  fl cx = 0, cy = 0, cz = 0, sx = 0, sy = 0, sz_ = 0;
+  setup_autobox(mols.getInitModel(), ligname, 4, cx, cy, cz, sx, sy, sz_);
+  grid_dims gd;
+  setup_grid_dims(cx, cy, cz, sx, sy, sz_, gd);
+  vec corner1(gd[0].begin, gd[1].begin, gd[2].begin);
+  vec corner2(gd[0].end, gd[1].end, gd[2].end);
+  grid user_grid;
+  const fl slope = 1e3;
+
+  //grid population
+  cache c("scoring_function_version001", gd, slope);
+  std::vector<smt> atom_types_needed;
+  m.get_movable_atom_types(atom_types_needed);
+  boost::timer::cpu_timer t;
+  c.populate(m, prec, atom_types_needed, user_grid, false);
+  res.grid_seconds = seconds(t);
+
+  //search parameters as in main_procedure
+  minimization_params minparm;
+  parallel_mc par;
+  sz heuristic = m.num_movable_atoms()
+      + 10 * m.get_size().num_degrees_of_freedom();
+  par.mc.num_steps = unsigned(70 * 3 * (50 + heuristic) / 2);
+  par.mc.ssd_par.evals = unsigned((25 + m.num_movable_atoms()) / 3);
+  minparm.maxiters = par.mc.ssd_par.evals;
+  par.mc.ssd_par.minparm = minparm;
+  par.mc.min_rmsd = 1.0;
+  par.mc.num_saved_mins = 50;
+  par.mc.hunt_cap = vec(10, 10, 10);
+  par.num_tasks = o.exhaustiveness;
+  par.display_progress = false;
+
+  //BFGS evaluations of random poses
+  {
+    counting_igrid counter(c);
+    rng generator(static_cast<rng::result_type>(o.seed));
+    quasi_newton qn(minparm);
+    change g(m.get_size(), false);
+    vec authentic_v(1000, 1000, 1000);
+    t.start();
+    for (unsigned i = 0; i < o.minimizations; i++) {
+      output_type out(m.get_initial_conf(false), max_fl);
+      out.c.randomize(corner1, corner2, generator);
+      qn(m, prec, counter, out, g, authentic_v, user_grid);
+    }
+    double secs = seconds(t);
+    res.bfgs_evals_per_sec = secs > 0 ? counter.evals / secs : 0;
+  }
+
+  //single Monte Carlo chain
+  {
+    monte_carlo mc(par.mc);
+    mc.num_steps = o.mc_steps;
+    rng generator(static_cast<rng::result_type>(o.seed));
+    output_container out;
+    t.start();
+    unsigned steps = mc(m, out, prec, c, corner1, corner2, NULL, generator,
+        user_grid);
+    double secs = seconds(t);
+    res.mc_steps_per_sec = secs > 0 ? steps / secs : 0;
+  }
+
+  //CNN scoring
+  cnn_options cnnopts;
+  if (o.no_cnn) {
+    cnnopts.cnn_scoring = CNNnone;
+  } else {
+    cnnopts.cnn_model_names.push_back(o.cnn_model);
+    cnnopts.seed = o.seed;
+  }
+  CNNScorer cnn(cnnopts);
+  if (cnn.initialized()) {
+    float aff = 0, loss = 0, variance = 0;
+    cnn.set_center_from_model(m);
+    cnn.score(m, false, aff, loss, variance); //warm up allocations
+    t.start();
+    for (unsigned i = 0; i < o.cnn_evals; i++)
+      cnn.score(m, false, aff, loss, variance);
+    double secs = seconds(t);
+    res.cnn_forwards_per_sec = secs > 0 ? o.cnn_evals / secs : 0;
+
+    t.start();
+    for (unsigned i = 0; i < o.cnn_evals; i++)
+      cnn.score(m, true, aff, loss, variance);
+    secs = seconds(t);
+    res.cnn_backwards_per_sec = secs > 0 ? o.cnn_evals / secs : 0;
+  }
+
+  //end to end docking of the ligand: search, refinement and rescoring;
+  //the hourly rate is for repeating this one docking
+  szv_grid_cache gridcache(m, prec.cutoff_sqr());
+  non_cache nc(gridcache, gd, &prec, slope);
+  for (unsigned i = 0, n = o.threads.size(); i < n; i++) {
+    par.num_threads = o.threads[i];
+    rng generator(static_cast<rng::result_type>(o.seed));
+    output_container out;
+    t.start();
+    par(m, out, prec, c, corner1, corner2, generator, user_grid);
+    quasi_newton qn(minparm);
+    change g(m.get_size(), false);
+    vec authentic_v(1000, 1000, 1000);
+    for (unsigned j = 0, nout = std::min(out.size(), sz(9)); j < nout; j++) {
+      qn(m, prec, nc, out[j], g, authentic_v, user_grid);
+      if (cnn.initialized()) {
+        float aff = 0, loss = 0, variance = 0;
+        m.set(out[j].c);
+        cnn.score(m, false, aff, loss, variance);
+      }
+    }
+    double secs = seconds(t);
+    res.ligands_per_hour.push_back(
+        make_pair(o.threads[i], secs > 0 ? 3600.0 / secs : 0));
+  }
+  return res;
+}
+
+static void write_json(ostream& out, const bench_options& o,
+    const vector<bench_result>& results) {
+  out << "{\n";
+  out << "  \"cnn\": \"" << (o.no_cnn ? string("none") : o.cnn_model) << "\",\n";
+  out << "  \"exhaustiveness\": " << o.exhaustiveness << ",\n";
+  out << "  \"gpu\": " << (o.gpu ? "true" : "false") << ",\n";
+  out << "  \"targets\": [\n";
+  for (unsigned i = 0, n = results.size(); i < n; i++) {
+    const bench_result& r = results[i];
+    out << "    {\n";
+    out << "      \"target\": \"" << r.target << "\",\n";
+    out << "      \"movable_atoms\": " << r.movable_atoms << ",\n";
+    out << "      \"degrees_of_freedom\": " << r.degrees_of_freedom << ",\n";
+    out << "      \"grid_seconds\": " << r.grid_seconds << ",\n";
+    out << "      \"mc_steps_per_sec\": " << r.mc_steps_per_sec << ",\n";
+    out << "      \"bfgs_evals_per_sec\": " << r.bfgs_evals_per_sec << ",\n";
+    out << "      \"cnn_forwards_per_sec\": " << r.cnn_forwards_per_sec << ",\n";
+    out << "      \"cnn_backwards_per_sec\": " << r.cnn_backwards_per_sec << ",\n";
+    out << "      \"ligands_per_hour\": {";
+    for (unsigned j = 0, nt = r.ligands_per_hour.size(); j < nt; j++) {
+      if (j > 0) out << ",";
+      out << " \"" << r.ligands_per_hour[j].first << "\": "
+          << r.ligands_per_hour[j].second;
+    }
+    out << " }\n";
+    out << "    }" << (i + 1 < n ? "," : "") << "\n";
+  }
+  out << "  ]\n";
+  out << "}\n";
+}
+
+//parse commandline options using boost::program_options and put the values in o
+//return true if successfull and ready to compute
+static bool parse_options(int argc, char *argv[], bench_options& o) {
+  using namespace boost::program_options;
+
+  options_description inputs("Input");
+  inputs.add_options()
+  ("data_dir", value<string>(&o.data_dir)->default_value(o.data_dir),
+      "directory containing TARGET_rec.pdb and TARGET_lig.sdf files")
+  ("targets", value<vector<string> >(&o.targets)->multitoken(),
+      "targets to benchmark (default 10gs 184l 3rod)");
+
+  options_description options("Options");
+  options.add_options()
+  ("threads", value<vector<int> >(&o.threads)->multitoken(),
+      "thread counts for end-to-end docking (default 1, 2, 4 ... number of CPUs)")
+  ("exhaustiveness", value<int>(&o.exhaustiveness)->default_value(8),
+      "exhaustiveness of end-to-end docking")
+  ("mc_steps", value<unsigned>(&o.mc_steps)->default_value(200),
+      "number of steps of the timed Monte Carlo chain")
+  ("minimizations", value<unsigned>(&o.minimizations)->default_value(50),
+      "number of timed BFGS minimizations")
+  ("cnn_evals", value<unsigned>(&o.cnn_evals)->default_value(20),
+      "number of timed CNN evaluations")
+  ("cnn", value<string>(&o.cnn_model)->default_value(o.cnn_model),
+      "built-in CNN model to benchmark")
+  ("no_cnn", bool_switch(&o.no_cnn), "skip CNN scoring")
+  ("gpu", bool_switch(&o.gpu), "run the CNN on the GPU")
+  ("seed", value<int>(&o.seed)->default_value(0), "random seed");
+
+  options_description outputs("Output");
+  outputs.add_options()
+  ("out,o", value<string>(&o.outname), "JSON output file (default stdout)");
+
+  options_description info("Information (optional)");
+  info.add_options()("help", bool_switch(&o.help), "display usage summary");
+
+  options_description desc;
+  desc.add(inputs).add(options).add(outputs).add(info);
+  variables_map vm;
+  try {
+    store(
+        command_line_parser(argc, argv).options(desc).style(
+            command_line_style::default_style
+                ^ command_line_style::allow_guessing).run(), vm);
+    notify(vm);
+  } catch (boost::program_options::error& e) {
+    std::cerr << "Command line parse error: " << e.what() << '\n'
+        << "\nCorrect usage:\n" << desc << '\n';
+    exit(-1);
+  }
+
+  if (o.help) {
+    cout << desc << '\n';
+    return false;
+  }
+
+  if (o.targets.size() == 0) {
+    o.targets.push_back("10gs");
+    o.targets.push_back("184l");
+    o.targets.push_back("3rod");
+  }
+  if (o.threads.size() == 0) {
+    int ncpu = boost::thread::hardware_concurrency();
+    for (int n = 1; n < ncpu; n *= 2)
+      o.threads.push_back(n);
+    o.threads.push_back(ncpu > 0 ? ncpu : 1);
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  OpenBabel::obErrorLog.StopLogging();
+  FLAGS_minloglevel = google::GLOG_ERROR; //don't spit out info messages
+  ::google::InitGoogleLogging(argv[0]);
+
+  try {
+    bench_options opt;
+    if (!parse_options(argc, argv, opt)) exit(0);
+
+    if (opt.gpu) {
+      caffe::Caffe::SetDevice(0);
+      caffe::Caffe::set_mode(caffe::Caffe::GPU);
+    } else {
+      caffe::Caffe::set_cudnn(false); //if cudnn is on, won't fallback to cpu
+    }
+
+    //default scoring function and approximation
+    custom_terms t;
+    builtin_scoring_functions.set(t, "vina");
+    weighted_terms wt(&t, t.weights());
+    precalculate_linear prec(wt, 32);
+
+    vector<bench_result> results;
+    for (unsigned i = 0, n = opt.targets.size(); i < n; i++) {
+      std::cerr << "Benchmarking " << opt.targets[i] << "\n";
+      results.push_back(run_target(opt, opt.targets[i], prec));
+    }
+
+    if (opt.outname.size() > 0) {
+      ofstream out(opt.outname.c_str());
+      if (!out) throw file_error(path(opt.outname), false);
+      write_json(out, opt, results);
+    } else {
+      write_json(cout, opt, results);
+    }
+  } catch (file_error& e) {
+    std::cerr << "\n\nError: could not open \"" << e.name.string() << "\" for "
+        << (e.in ? "reading" : "writing") << ".\n";
+    return -1;
+  } catch (usage_error& e) {
+    std::cerr << "\n\nUsage error: " << e.what() << "\n";
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * bfloat16.h
+ *
+ *  bfloat16 is the upper half of an IEEE float: the same exponent range with
+ *  8 bits of precision, so any finite float converts to a finite value
+ *  within a relative error of 2^-8 (floats beyond the largest bfloat16
+ *  saturate to it rather than round to inf), and converting back is a shift.
+ */
+
+#ifndef SMINA_BFLOAT16_H
+#define SMINA_BFLOAT16_H
+
+#include <cstring>
+#include <stdint.h>
+
+struct bfloat16 {
+    uint16_t bits;
+
+    bfloat16()
+        : bits(0) {
+    }
+
+    //round to nearest even
+    explicit bfloat16(float f) {
+      uint32_t u;
+      memcpy(&u, &f, sizeof(u));
+      if ((u & 0x7fffffff) > 0x7f800000) //keep nans nans
+        bits = (u >> 16) | 0x40;
+      else {
+        bits = (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+        if ((bits & 0x7fff) == 0x7f80 && (u & 0x7fffffff) != 0x7f800000)
+          bits--; //rounded a finite float up to inf
+      }
+    }
+
+    operator float() const {
+      uint32_t u = uint32_t(bits) << 16;
+      float f;
+      memcpy(&f, &u, sizeof(f));
+      return f;
+    }
+
+    template<class Archive>
+    void serialize(Archive& ar, const unsigned version) {
+      ar & bits;
+    }
+};
+
+#endif /* SMINA_BFLOAT16_H */
@@ -0,0 +1,485 @@
+/*
+ * bgzf.cpp
+ */
+
+#include "bgzf.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <zlib.h>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace {
+
+const unsigned BGZF_BLOCK_SIZE = 0xff00; //uncompressed bytes per block
+const unsigned BGZF_MAX_BLOCK = 0x10000; //max size of a compressed member
+const unsigned BGZF_HEADER = 18;
+const unsigned BGZF_FOOTER = 8;
+const unsigned GZIP_MIN_HEADER = 12; //fixed header plus xlen
+
+//empty block that marks the end of a BGZF file
+const unsigned char bgzf_eof[28] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0,
+    66, 67, 2, 0, 27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+inline unsigned get16(const unsigned char *p) {
+  return p[0] | (p[1] << 8);
+}
+
+inline unsigned get32(const unsigned char *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned) p[3] << 24);
+}
+
+inline void put32(unsigned char *p, unsigned v) {
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+//given at least GZIP_MIN_HEADER+xlen bytes of a member header, return the
+//total size of the member from its BC field, or 0 if it isn't a BGZF block
+unsigned bgzf_block_size(const unsigned char *h, unsigned n) {
+  if (n < GZIP_MIN_HEADER || h[0] != 31 || h[1] != 139 || h[2] != 8
+      || h[3] != 4) return 0;
+  unsigned xlen = get16(h + 10);
+  if (n < GZIP_MIN_HEADER + xlen) return 0;
+  const unsigned char *x = h + GZIP_MIN_HEADER;
+  for (unsigned i = 0; i + 4 <= xlen;) {
+    unsigned slen = get16(x + i + 2);
+    if (x[i] == 'B' && x[i + 1] == 'C' && slen == 2 && i + 6 <= xlen)
+      return get16(x + i + 4) + 1;
+    i += 4 + slen;
+  }
+  return 0;
+}
+
+//a unit of work for the pool; in/out are compressed or uncompressed
+//depending on direction
+struct gz_block {
+    std::string in;
+    std::string out;
+    std::string error;
+    bool done;
+
+    gz_block()
+        : done(false) {
+    }
+};
+
+typedef boost::shared_ptr<gz_block> block_ptr;
+
+void deflate_block(gz_block& b, int level) {
+  b.out.resize(BGZF_MAX_BLOCK);
+  unsigned char *out = (unsigned char*) &b.out[0];
+  uLong csize = 0;
+  for (;;) {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY)
+        != Z_OK) {
+      b.error = "could not initialize compression";
+      return;
+    }
+    zs.next_in = (Bytef*) b.in.data();
+    zs.avail_in = b.in.size();
+    zs.next_out = out + BGZF_HEADER;
+    zs.avail_out = BGZF_MAX_BLOCK - BGZF_HEADER - BGZF_FOOTER;
+    int ret = deflate(&zs, Z_FINISH);
+    csize = zs.total_out;
+    deflateEnd(&zs);
+    if (ret == Z_STREAM_END) break;
+    if (level == 0) {
+      b.error = "block too large to compress";
+      return;
+    }
+    level = 0; //incompressible data, storing always fits
+  }
+
+  unsigned total = BGZF_HEADER + csize + BGZF_FOOTER;
+  const unsigned char header[BGZF_HEADER] = { 31, 139, 8, 4, 0, 0, 0, 0, 0,
+      255, 6, 0, 'B', 'C', 2, 0, (unsigned char) ((total - 1) & 0xff),
+      (unsigned char) ((total - 1) >> 8) };
+  std::memcpy(out, header, BGZF_HEADER);
+  uLong crc = crc32(0L, (const Bytef*) b.in.data(), b.in.size());
+  put32(out + BGZF_HEADER + csize, crc);
+  put32(out + BGZF_HEADER + csize + 4, b.in.size());
+  b.out.resize(total);
+}
+
+void inflate_block(gz_block& b) {
+  const unsigned char *data = (const unsigned char*) b.in.data();
+  unsigned n = b.in.size();
+  unsigned start = GZIP_MIN_HEADER + get16(data + 10);
+  if (n < start + BGZF_FOOTER) {
+    b.error = "truncated gzip block";
+    return;
+  }
+  unsigned crc = get32(data + n - 8);
+  unsigned isize = get32(data + n - 4);
+  if (isize > BGZF_MAX_BLOCK) { //members never hold more than a block
+    b.error = "corrupt gzip block";
+    return;
+  }
+  b.out.resize(isize);
+  if (isize == 0) return;
+
+  z_stream zs;
+  std::memset(&zs, 0, sizeof(zs));
+  if (inflateInit2(&zs, -15) != Z_OK) {
+    b.error = "could not initialize decompression";
+    return;
+  }
+  zs.next_in = (Bytef*) data + start;
+  zs.avail_in = n - start - BGZF_FOOTER;
+  zs.next_out = (Bytef*) &b.out[0];
+  zs.avail_out = isize;
+  int ret = inflate(&zs, Z_FINISH);
+  inflateEnd(&zs);
+  if (ret != Z_STREAM_END || zs.total_out != isize)
+    b.error = "corrupt gzip block";
+  else
+    if (crc32(0L, (const Bytef*) b.out.data(), isize) != crc)
+      b.error = "gzip block failed crc check";
+}
+
+//fixed set of threads that process blocks in the order submitted; the
+//owner collects them in order with wait
+class block_pool {
+    boost::thread_group threads;
+    boost::mutex lock;
+    boost::condition_variable work_ready;
+    boost::condition_variable work_done;
+    std::deque<block_ptr> queue;
+    boost::function<void(gz_block&)> process;
+    bool stopping;
+
+    void run() {
+      for (;;) {
+        block_ptr b;
+        {
+          boost::mutex::scoped_lock lk(lock);
+          while (queue.empty() && !stopping)
+            work_ready.wait(lk);
+          if (stopping) return; //abandon anything not yet started
+          b = queue.front();
+          queue.pop_front();
+        }
+        process(*b);
+        {
+          boost::mutex::scoped_lock lk(lock);
+          b->done = true;
+        }
+        work_done.notify_all();
+      }
+    }
+
+  public:
+    block_pool(const boost::function<void(gz_block&)>& f, unsigned n)
+        : process(f), stopping(false) {
+      if (n == 0) n = boost::thread::hardware_concurrency();
+      if (n == 0) n = 1;
+      for (unsigned i = 0; i < n; i++)
+        threads.create_thread(boost::bind(&block_pool::run, this));
+    }
+
+    ~block_pool() {
+      {
+        boost::mutex::scoped_lock lk(lock);
+        stopping = true;
+      }
+      work_ready.notify_all();
+      threads.join_all();
+    }
+
+    unsigned size() const {
+      return threads.size();
+    }
+
+    void submit(const block_ptr& b) {
+      {
+        boost::mutex::scoped_lock lk(lock);
+        queue.push_back(b);
+      }
+      work_ready.notify_one();
+    }
+
+    bool ready(const block_ptr& b) {
+      boost::mutex::scoped_lock lk(lock);
+      return b->done;
+    }
+
+    //block until b is processed, throw if it failed
+    void wait(const block_ptr& b) {
+      boost::mutex::scoped_lock lk(lock);
+      while (!b->done)
+        work_done.wait(lk);
+      if (b->error.size() > 0) throw std::ios_base::failure(b->error);
+    }
+};
+
+}
+
+bool is_bgzf(std::istream& in) {
+  unsigned char h[BGZF_HEADER];
+  std::streampos pos = in.tellg();
+  in.read((char*) h, BGZF_HEADER);
+  std::streamsize n = in.gcount();
+  in.clear();
+  in.seekg(pos);
+  return bgzf_block_size(h, n) > 0;
+}
+
+/////////////////// compression ///////////////////
+
+struct bgzf_compressor::impl {
+    std::ostream& out;
+    block_pool pool;
+    std::deque<block_ptr> pending; //submitted blocks in file order
+    block_ptr current; //block being filled
+    bool closed;
+
+    impl(std::ostream& o, unsigned threads, int level)
+        : out(o), pool(boost::bind(deflate_block, _1, level), threads),
+            closed(false) {
+    }
+
+    ~impl() {
+      try {
+        close();
+      } catch (...) {
+      }
+    }
+
+    //write finished blocks, waiting if too many are outstanding
+    void drain(bool all) {
+      while (!pending.empty()) {
+        block_ptr b = pending.front();
+        if (!all && pending.size() <= 2 * pool.size() && !pool.ready(b))
+          break;
+        pool.wait(b);
+        out.write(b->out.data(), b->out.size());
+        pending.pop_front();
+      }
+    }
+
+    void submit() {
+      if (current && current->in.size() > 0) {
+        pool.submit(current);
+        pending.push_back(current);
+      }
+      current.reset();
+      drain(false);
+    }
+
+    void write(const char *s, std::streamsize n) {
+      while (n > 0) {
+        if (!current) {
+          current = boost::make_shared<gz_block>();
+          current->in.reserve(BGZF_BLOCK_SIZE);
+        }
+        std::streamsize amt = std::min<std::streamsize>(n,
+            BGZF_BLOCK_SIZE - current->in.size());
+        current->in.append(s, amt);
+        s += amt;
+        n -= amt;
+        if (current->in.size() == BGZF_BLOCK_SIZE) submit();
+      }
+    }
+
+    bool flush() {
+      submit();
+      drain(true);
+      out.flush();
+      return out.good();
+    }
+
+    void close() {
+      if (closed) return;
+      closed = true;
+      submit();
+      drain(true);
+      out.write((const char*) bgzf_eof, sizeof(bgzf_eof));
+      out.flush();
+    }
+};
+
+bgzf_compressor::bgzf_compressor(std::ostream& out, unsigned threads,
+    int level)
+    : pimpl(new impl(out, threads, level)) {
+}
+
+std::streamsize bgzf_compressor::write(const char *s, std::streamsize n) {
+  pimpl->write(s, n);
+  return n;
+}
+
+bool bgzf_compressor::flush() {
+  return pimpl->flush();
+}
+
+void bgzf_compressor::close() {
+  pimpl->close();
+}
+
+/////////////////// decompression ///////////////////
+
+struct bgzf_decompressor::impl {
+    std::istream& in;
+    block_pool pool;
+    std::deque<block_ptr> pending; //blocks being decompressed in file order
+    block_ptr current; //block being returned to the reader
+    size_t pos; //read position in current->out
+    std::string carry; //bytes read from in but not yet consumed
+
+    //a member without a BC field is inflated serially as a stream
+    bool serial_next; //carry starts with such a member
+    bool serial;
+    z_stream zs;
+    std::string inbuf;
+    bool eof;
+
+    impl(std::istream& i, unsigned threads)
+        : in(i), pool(inflate_block, threads), pos(0), serial_next(false),
+            serial(false), eof(false) {
+      std::memset(&zs, 0, sizeof(zs));
+    }
+
+    ~impl() {
+      if (serial) inflateEnd(&zs);
+    }
+
+    //append up to n bytes from the file to buf, return number read
+    size_t fill(std::string& buf, size_t n) {
+      size_t got = 0;
+      if (carry.size() > 0) {
+        got = std::min(n, carry.size());
+        buf.append(carry, 0, got);
+        carry.erase(0, got);
+      }
+      if (got < n && in) {
+        size_t old = buf.size();
+        buf.resize(old + n - got);
+        in.read(&buf[old], n - got);
+        size_t r = in.gcount();
+        buf.resize(old + r);
+        got += r;
+      }
+      return got;
+    }
+
+    //read the next member from the file and queue it for decompression,
+    //return false at end of file or if the next member must be done serially
+    bool read_block() {
+      if (eof || serial_next) return false;
+      std::string header;
+      fill(header, GZIP_MIN_HEADER);
+      if (header.size() == 0) {
+        eof = true;
+        return false;
+      }
+      const unsigned char *h = (const unsigned char*) header.data();
+      unsigned bsize = 0;
+      if (header.size() == GZIP_MIN_HEADER && h[3] == 4) {
+        fill(header, get16(h + 10));
+        h = (const unsigned char*) header.data();
+        bsize = bgzf_block_size(h, header.size());
+      }
+      if (bsize == 0 || bsize < header.size()) {
+        //not a BGZF block, hand it to the serial decompressor
+        carry = header + carry;
+        serial_next = true;
+        return false;
+      }
+      block_ptr b = boost::make_shared<gz_block>();
+      b->in.swap(header);
+      b->in.reserve(bsize);
+      size_t want = bsize - b->in.size();
+      if (fill(b->in, want) < want)
+        throw std::ios_base::failure("truncated gzip block");
+      pool.submit(b);
+      pending.push_back(b);
+      return true;
+    }
+
+    //inflate serially into s, return bytes produced
+    std::streamsize read_serial(char *s, std::streamsize n) {
+      zs.next_out = (Bytef*) s;
+      zs.avail_out = n;
+      while (zs.avail_out > 0) {
+        if (zs.avail_in == 0) {
+          inbuf.clear();
+          if (fill(inbuf, 1 << 16) == 0)
+            throw std::ios_base::failure("truncated gzip stream");
+          zs.next_in = (Bytef*) inbuf.data();
+          zs.avail_in = inbuf.size();
+        }
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+          //return unused input so the next member can be examined
+          carry.assign((const char*) zs.next_in, zs.avail_in);
+          inflateEnd(&zs);
+          serial = false;
+          break;
+        } else
+          if (ret != Z_OK)
+            throw std::ios_base::failure("corrupt gzip stream");
+      }
+      return n - zs.avail_out;
+    }
+
+    std::streamsize read(char *s, std::streamsize n) {
+      std::streamsize done = 0;
+      while (done < n) {
+        if (current && pos < current->out.size()) {
+          size_t amt = std::min<size_t>(n - done, current->out.size() - pos);
+          std::memcpy(s + done, current->out.data() + pos, amt);
+          pos += amt;
+          done += amt;
+          continue;
+        }
+        current.reset();
+
+        if (serial) {
+          done += read_serial(s + done, n - done);
+          continue;
+        }
+
+        //keep every thread busy
+        while (pending.size() < 2 * pool.size() && read_block())
+          ;
+
+        if (!pending.empty()) {
+          current = pending.front();
+          pending.pop_front();
+          pool.wait(current);
+          pos = 0;
+        } else
+          if (serial_next) {
+            serial_next = false;
+            std::memset(&zs, 0, sizeof(zs));
+            if (inflateInit2(&zs, 15 + 16) != Z_OK)
+              throw std::ios_base::failure(
+                  "could not initialize decompression");
+            serial = true;
+          } else
+            break; //end of file
+      }
+      return done > 0 ? done : -1;
+    }
+};
+
+bgzf_decompressor::bgzf_decompressor(std::istream& in, unsigned threads)
+    : pimpl(new impl(in, threads)) {
+}
+
+std::streamsize bgzf_decompressor::read(char *s, std::streamsize n) {
+  return pimpl->read(s, n);
+}
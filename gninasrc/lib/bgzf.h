@@ -0,0 +1,62 @@
+/*
+ * bgzf.h
+ *
+ *  Blocked gzip streams that compress and decompress in parallel.
+ *  Data is split into independent gzip members of at most 64KB, each
+ *  carrying its compressed size in a "BC" extra field (the BGZF layout used
+ *  by samtools).  The result is an ordinary multi-member gzip file, so gzip,
+ *  zcat and any other reader still work, but because members do not depend
+ *  on each other they can be (de)compressed on a pool of threads.
+ */
+
+#ifndef SMINA_BGZF_H
+#define SMINA_BGZF_H
+
+#include <iosfwd>
+#include <boost/shared_ptr.hpp>
+#include <boost/iostreams/categories.hpp>
+
+//true if in is positioned at the start of a BGZF block; in is not advanced
+bool is_bgzf(std::istream& in);
+
+//boost iostreams sink that writes BGZF to out; data is buffered into blocks
+//that are compressed by threads background threads (0 for one per core)
+class bgzf_compressor {
+  public:
+    typedef char char_type;
+    struct category : boost::iostreams::sink_tag,
+        boost::iostreams::closable_tag, boost::iostreams::flushable_tag {
+    };
+
+    bgzf_compressor(std::ostream& out, unsigned threads = 0, int level = -1);
+
+    std::streamsize write(const char *s, std::streamsize n);
+    //compresses any partial block and writes everything through to out, so
+    //out ends on a block boundary
+    bool flush();
+    //compresses any partial block and writes the end of file marker
+    void close();
+
+    struct impl;
+  private:
+    boost::shared_ptr<impl> pimpl; //devices are copied into the chain
+};
+
+//boost iostreams source that reads a gzip file written by bgzf_compressor,
+//decompressing blocks ahead of the reader in parallel; members without
+//the BC field (e.g. from plain gzip) are decompressed serially
+class bgzf_decompressor {
+  public:
+    typedef char char_type;
+    typedef boost::iostreams::source_tag category;
+
+    bgzf_decompressor(std::istream& in, unsigned threads = 0);
+
+    std::streamsize read(char *s, std::streamsize n);
+
+    struct impl;
+  private:
+    boost::shared_ptr<impl> pimpl;
+};
+
+#endif /* SMINA_BGZF_H */
@@ -47,3 +47,16 @@ void setup_autobox(const model& m, const std::string& autobox_ligand, fl autobox
     throw usage_error(msg.str());
   }
 }
+
+void setup_grid_dims(fl center_x, fl center_y, fl center_z, fl size_x,
+    fl size_y, fl size_z, grid_dims& gd) {
+  vec span(size_x, size_y, size_z);
+  vec center(center_x, center_y, center_z);
+  VINA_FOR_IN(i, gd)
+  {
+    gd[i].n = sz(std::ceil(span[i] / box_granularity));
+    fl real_span = box_granularity * gd[i].n;
+    gd[i].begin = center[i] - real_span / 2;
+    gd[i].end = gd[i].begin + real_span;
+  }
+}
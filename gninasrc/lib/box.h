@@ -3,6 +3,7 @@
 #include <openbabel/atom.h>
 #include <cmath> // for ceila
 #include "common.h"
+#include "grid_dim.h"
 
 #ifndef SMINA_BOX_H
 #define SMINA_BOX_H
@@ -59,4 +60,10 @@ class model;
 void setup_autobox(const model& m, const std::string& autobox_ligand, fl autobox_add,
     fl& center_x, fl& center_y, fl& center_z, fl& size_x, fl& size_y, fl& size_z);
 
+const fl box_granularity = 0.375;
+
+//set grid dims to match center/size
+void setup_grid_dims(fl center_x, fl center_y, fl center_z, fl size_x,
+    fl size_y, fl size_z, grid_dims& gd);
+
 #endif /* SMINA_BOX_H */
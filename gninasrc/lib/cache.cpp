@@ -37,11 +37,12 @@ typedef boost::archive::text_oarchive oarchive;
 #include "cache.h"
 #include "file.h"
 #include "szv_grid.h"
+#include "metrics.h"
 
 cache::cache(const std::string& scoring_function_version_, const grid_dims& gd_,
-    fl slope_)
+    fl slope_, bool compact_)
     : scoring_function_version(scoring_function_version_), gd(gd_),
-        slope(slope_), grids(num_atom_types()) {
+        slope(slope_), compact(compact_), grids(num_atom_types()) {
 }
 
 fl cache::eval(const model& m, fl v) const { // needs m.coords
@@ -59,6 +60,15 @@ fl cache::eval(const model& m, fl v) const { // needs m.coords
   return e;
 }
 
+fl cache::eval_atom(const model& m, sz i, const vec& coords, fl v) const {
+  const atom& a = m.atoms[i];
+  smt t = a.get();
+  if (t >= num_atom_types() || is_hydrogen(t)) return 0;
+  const grid& g = grids[t];
+  assert(g.initialized());
+  return g.evaluate(a, coords, slope, v);
+}
+
 fl cache::eval_deriv(model& m, fl v, const grid& user_grid) const { // needs m.coords, sets m.minus_forces
   fl e = 0;
   sz nat = num_atom_types();
@@ -101,6 +111,7 @@ void cache::load(Archive& ar, const unsigned version) {
 void cache::populate(const model& m, const precalculate& p,
     const std::vector<smt>& atom_types_needed, grid& user_grid,
     bool display_progress) {
+  metric_timer timer(MetricGridPopulate);
   std::vector<smt> needed;
   bool haschargeterms = p.has_components();
 
@@ -108,7 +119,7 @@ void cache::populate(const model& m, const precalculate& p,
     smt t = atom_types_needed[i];
     if (!grids[t].initialized()) {
       needed.push_back(t);
-      grids[t].init(gd, haschargeterms);
+      grids[t].init(gd, haschargeterms, compact);
     }
   }
   if (needed.empty()) return;
@@ -125,9 +136,9 @@ void cache::populate(const model& m, const precalculate& p,
   szv_grid_cache igcache(m, cutoff_sqr);
   szv_grid ig(igcache, gd);
 
-  VINA_FOR(x, g.data.dim0()) {
-    VINA_FOR(y, g.data.dim1()) {
-      VINA_FOR(z, g.data.dim2()) {
+  VINA_FOR(x, gd[0].n + 1) {
+    VINA_FOR(y, gd[1].n + 1) {
+      VINA_FOR(z, gd[2].n + 1) {
         std::fill(affinities.begin(), affinities.end(), 0);
         std::fill(chargeaffinities.begin(), chargeaffinities.end(), 0);
         vec probe_coords;
@@ -166,12 +177,20 @@ void cache::populate(const model& m, const precalculate& p,
         VINA_FOR_IN(j, needed) {
           sz t = needed[j];
           assert(t < nat);
-          grids[t].data(x, y, z) = affinities[j]; //+ user_grid.evaluate_user(vec(x, y, z));
-          if (haschargeterms) grids[t].chargedata(x, y, z) =
-              chargeaffinities[j];
+          fl value = affinities[j]; //+ user_grid.evaluate_user(vec(x, y, z));
           if (user_grid.initialized())
-            grids[t].data(x, y, z) += user_grid.evaluate_user(vec(x, y, z),
-                slope);
+            value += user_grid.evaluate_user(vec(x, y, z), slope);
+          //compact grids are rounded point by point, so no float copy of
+          //the grids is ever made
+          if (compact) {
+            grids[t].data16(x, y, z) = bfloat16(value);
+            if (haschargeterms) grids[t].chargedata16(x, y, z) = bfloat16(
+                chargeaffinities[j]);
+          } else {
+            grids[t].data(x, y, z) = value;
+            if (haschargeterms) grids[t].chargedata(x, y, z) =
+                chargeaffinities[j];
+          }
         }
       }
     }
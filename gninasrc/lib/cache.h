@@ -39,10 +39,15 @@ struct energy_mismatch : public cache_mismatch {
 };
 
 struct cache : public igrid {
+    //if compact, populated grids are stored as bfloat16
     cache(const std::string& scoring_function_version_, const grid_dims& gd_,
-        fl slope_);
+        fl slope_, bool compact_ = false);
     fl eval(const model& m, fl v) const; // needs m.coords // clean up
     fl eval_deriv(model& m, fl v, const grid& user_grid) const; // needs m.coords, sets m.minus_forces // clean up
+    virtual bool can_eval_atom() const {
+      return true;
+    }
+    fl eval_atom(const model& m, sz i, const vec& coords, fl v) const;
 
     virtual void populate(const model& m, const precalculate& p,
         const std::vector<smt>& atom_types_needed, grid& user_grid,
@@ -55,6 +60,7 @@ struct cache : public igrid {
     atomv atoms; // for verification
     grid_dims gd;
     fl slope; // does not get (de-)serialized
+    bool compact; // does not get (de-)serialized
     std::vector<grid> grids;
     friend class boost::serialization::access;
     friend class cache_gpu;
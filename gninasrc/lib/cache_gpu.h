@@ -16,6 +16,9 @@ struct cache_gpu : public cache {
 
     virtual ~cache_gpu() {
     }
+    virtual bool can_eval_atom() const {
+      return false;
+    } //grids are on the device
     virtual void populate(const model& m, const precalculate& p,
         const std::vector<smt>& atom_types_needed, grid& user_grid,
         bool display_progress = true);
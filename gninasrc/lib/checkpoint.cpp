@@ -0,0 +1,58 @@
+/*
+ * checkpoint.cpp
+ */
+
+#include "checkpoint.h"
+#include <fstream>
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <boost/filesystem.hpp>
+#include "file.h"
+
+static const char checkpoint_magic[] = "gnina_checkpoint";
+//version 1 has no scores line
+static const unsigned checkpoint_version = 2;
+
+bool checkpoint::read(const std::string& fname) {
+  if (!boost::filesystem::exists(fname)) return false;
+  ifile in(fname);
+  std::string magic, rec, o, f, a, s = "scores";
+  unsigned version = 0;
+  in >> magic >> version >> rec >> next_record >> o >> out >> f >> flex >> a
+      >> atoms;
+  scores = 0;
+  if (version >= 2) in >> s >> scores;
+  if (!in || magic != checkpoint_magic || version < 1
+      || version > checkpoint_version || rec != "next_record" || o != "out"
+      || f != "flex" || a != "atoms" || s != "scores")
+    throw usage_error("Invalid checkpoint file " + fname);
+  return true;
+}
+
+void checkpoint::write(const std::string& fname) const {
+  path target(fname);
+  path tmpname = target.parent_path()
+      / boost::filesystem::unique_path(target.filename().string() + ".%%%%%%");
+  {
+    ofile cp(tmpname);
+    cp << checkpoint_magic << " " << checkpoint_version << "\n";
+    cp << "next_record " << next_record << "\n";
+    cp << "out " << out << "\n";
+    cp << "flex " << flex << "\n";
+    cp << "atoms " << atoms << "\n";
+    cp << "scores " << scores << "\n";
+    cp.flush();
+    if (!cp) throw file_error(tmpname, false);
+  }
+#ifndef WIN32
+  //the contents must be on disk before the rename can make them current,
+  //or a crash could leave an empty checkpoint in place of the old one
+  int fd = ::open(tmpname.c_str(), O_RDONLY);
+  bool synced = fd >= 0 && ::fsync(fd) == 0;
+  if (fd >= 0) ::close(fd);
+  if (!synced) throw file_error(tmpname, false);
+#endif
+  boost::filesystem::rename(tmpname, target);
+}
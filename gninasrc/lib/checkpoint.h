@@ -0,0 +1,38 @@
+/*
+ * checkpoint.h
+ */
+
+#ifndef SMINA_CHECKPOINT_H
+#define SMINA_CHECKPOINT_H
+
+#include <string>
+#include <iosfwd>
+#include "common.h"
+
+/* Progress of a run through its ligands, so that a run that is killed can be
+ * resumed.  The writer periodically flushes the outputs and records the
+ * first input record that has not been written along with the size of each
+ * output at that point.  A resumed run truncates the outputs back to those
+ * sizes, discarding anything written after the checkpoint, and skips the
+ * input records before next_record without preparing them.
+ */
+struct checkpoint {
+    sz next_record; //input records before this are all in the outputs
+    std::streamoff out; //sizes of the output files at that point
+    std::streamoff flex;
+    std::streamoff atoms;
+    std::streamoff scores;
+
+    checkpoint()
+        : next_record(0), out(0), flex(0), atoms(0), scores(0) {
+    }
+
+    //read fname, return false if it does not exist
+    bool read(const std::string& fname);
+
+    //replace fname atomically, so a run killed mid write leaves the previous
+    //checkpoint intact
+    void write(const std::string& fname) const;
+};
+
+#endif /* SMINA_CHECKPOINT_H */
@@ -0,0 +1,247 @@
+/*
+ * cnn_bundle.cpp
+ */
+
+#include "cnn_bundle.h"
+#include <cstring>
+#include <boost/filesystem.hpp>
+
+#include "common.h"
+#include "file.h"
+
+using namespace std;
+
+//file layout:
+//  "GNINACNN", uint32 version, uint32 number of models
+//  per model: string name, uint64 source hash, string graph,
+//    uint32 number of weights
+//    per weight: string layer, uint32 index, uint64 count, uint64 offset
+//  weights, each starting on a kAlignment byte boundary
+//strings are a uint32 length followed by the characters
+static const char kMagic[8] = { 'G', 'N', 'I', 'N', 'A', 'C', 'N', 'N' };
+static const unsigned kVersion = 2; //version 1 has no source hashes
+static const unsigned long long kAlignment = 64;
+
+//bounds checked reads from the index of a mapped bundle
+struct bundle_reader {
+    const char *pos;
+    const char *end;
+    const string& fname;
+
+    bundle_reader(const char *b, const char *e, const string& f)
+        : pos(b), end(e), fname(f) {
+    }
+
+    void read(void *dst, size_t n) {
+      if (n > size_t(end - pos))
+        throw usage_error("Truncated CNN model bundle " + fname);
+      memcpy(dst, pos, n);
+      pos += n;
+    }
+
+    template<typename T> T get() {
+      T ret;
+      read(&ret, sizeof(T));
+      return ret;
+    }
+
+    string get_string() {
+      unsigned n = get<unsigned>();
+      if (n > size_t(end - pos))
+        throw usage_error("Truncated CNN model bundle " + fname);
+      string ret(pos, n);
+      pos += n;
+      return ret;
+    }
+};
+
+template<typename T>
+static void put(string& out, T val) {
+  out.append((const char*) &val, sizeof(T));
+}
+
+static void put_string(string& out, const string& s) {
+  put<unsigned>(out, s.size());
+  out += s;
+}
+
+cnn_bundle::cnn_bundle(const string& fname) {
+  if (!boost::filesystem::exists(fname))
+    throw file_error(fname, true);
+  //private mapping so a stray write to a weight costs a page copy instead
+  //of a crash or a modified bundle
+  file.reset(new boost::iostreams::mapped_file());
+  try {
+    file->open(fname, boost::iostreams::mapped_file::priv);
+  } catch (std::exception&) {
+    throw file_error(fname, true);
+  }
+
+  const char *base = file->const_data();
+  unsigned long long size = file->size();
+  bundle_reader in(base, base + size, fname);
+
+  char magic[sizeof(kMagic)];
+  in.read(magic, sizeof(magic));
+  if (memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+    throw usage_error(fname + " is not a CNN model bundle");
+  unsigned version = in.get<unsigned>();
+  if (version < kVersion)
+    return; //nothing can be checked against the built-in models
+  if (version != kVersion)
+    throw usage_error("Unsupported CNN model bundle version in " + fname);
+
+  unsigned nmodels = in.get<unsigned>();
+  for (unsigned i = 0; i < nmodels; i++) {
+    string name = in.get_string();
+    model_entry& m = models[name];
+    m.source = in.get<unsigned long long>();
+    m.graph = in.get_string();
+    unsigned nweights = in.get<unsigned>();
+    m.weights.resize(nweights);
+    for (unsigned j = 0; j < nweights; j++) {
+      weight& w = m.weights[j];
+      w.layer = in.get_string();
+      w.index = in.get<unsigned>();
+      w.count = in.get<unsigned long long>();
+      w.offset = in.get<unsigned long long>();
+      if (w.offset % kAlignment != 0 || w.offset > size
+          || w.count > (size - w.offset) / sizeof(Dtype))
+        throw usage_error("Corrupt CNN model bundle " + fname);
+    }
+  }
+}
+
+unsigned long long cnn_bundle::source(const string& name) const {
+  auto pos = models.find(name);
+  return pos == models.end() ? 0 : pos->second.source;
+}
+
+unsigned long long cnn_bundle::hash(const void *data, size_t n,
+    unsigned long long h) {
+  const unsigned char *bytes = (const unsigned char*) data;
+  for (size_t i = 0; i < n; i++) {
+    h ^= bytes[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+void cnn_bundle::get_graph(const string& name,
+    caffe::NetParameter& param) const {
+  const model_entry& m = models.at(name);
+  if (!param.ParseFromString(m.graph))
+    throw usage_error("Corrupt graph for " + name + " in CNN model bundle");
+}
+
+void cnn_bundle::set_weights(const string& name,
+    caffe::Net<Dtype>& net) const {
+  const model_entry& m = models.at(name);
+  unsigned nblobs = 0;
+  for (unsigned i = 0, n = net.layers().size(); i < n; i++)
+    nblobs += net.layers()[i]->blobs().size();
+  if (nblobs != m.weights.size())
+    throw usage_error("CNN model bundle does not match model " + name);
+
+  char *base = file->data();
+  for (unsigned i = 0, n = m.weights.size(); i < n; i++) {
+    const weight& w = m.weights[i];
+    caffe::shared_ptr<caffe::Layer<Dtype> > layer = net.layer_by_name(w.layer);
+    if (!layer || w.index >= layer->blobs().size()
+        || (unsigned long long) layer->blobs()[w.index]->count() != w.count)
+      throw usage_error("CNN model bundle does not match model " + name);
+    if (w.count > 0)
+      layer->blobs()[w.index]->set_cpu_data((Dtype*) (base + w.offset));
+  }
+}
+
+void cnn_bundle::add(const string& name, const caffe::NetParameter& graph,
+    const caffe::Net<Dtype>& net, unsigned long long source) {
+  model_entry& m = models[name];
+  m.source = source;
+  //weights come from the bundle, so filling them at setup is wasted work;
+  //the default filler is a constant
+  caffe::NetParameter g(graph);
+  for (int i = 0, n = g.layer_size(); i < n; i++) {
+    caffe::LayerParameter *layer = g.mutable_layer(i);
+    if (layer->has_convolution_param()) {
+      layer->mutable_convolution_param()->clear_weight_filler();
+      layer->mutable_convolution_param()->clear_bias_filler();
+    }
+    if (layer->has_inner_product_param()) {
+      layer->mutable_inner_product_param()->clear_weight_filler();
+      layer->mutable_inner_product_param()->clear_bias_filler();
+    }
+    if (layer->has_scale_param()) {
+      layer->mutable_scale_param()->clear_filler();
+      layer->mutable_scale_param()->clear_bias_filler();
+    }
+  }
+  g.SerializeToString(&m.graph);
+
+  m.weights.clear();
+  const vector<caffe::shared_ptr<caffe::Layer<Dtype> > >& layers = net.layers();
+  for (unsigned i = 0, n = layers.size(); i < n; i++) {
+    for (unsigned j = 0, nb = layers[i]->blobs().size(); j < nb; j++) {
+      const caffe::Blob<Dtype>& blob = *layers[i]->blobs()[j];
+      m.weights.push_back(weight());
+      weight& w = m.weights.back();
+      w.layer = net.layer_names()[i];
+      w.index = j;
+      w.count = blob.count();
+      w.offset = 0;
+      w.values.assign(blob.cpu_data(), blob.cpu_data() + blob.count());
+    }
+  }
+}
+
+void cnn_bundle::write(const string& fname) const {
+  //the size of the index doesn't depend on the offsets in it, so lay it out
+  //once to find where the weights start and then again with their offsets
+  string index;
+  for (unsigned pass = 0; pass < 2; pass++) {
+    unsigned long long offset = (index.size() + kAlignment - 1) / kAlignment
+        * kAlignment;
+    index.clear();
+    index.append(kMagic, sizeof(kMagic));
+    put<unsigned>(index, kVersion);
+    put<unsigned>(index, models.size());
+    for (auto& item : models) {
+      put_string(index, item.first);
+      put<unsigned long long>(index, item.second.source);
+      put_string(index, item.second.graph);
+      put<unsigned>(index, item.second.weights.size());
+      for (const weight& w : item.second.weights) {
+        put_string(index, w.layer);
+        put<unsigned>(index, w.index);
+        put<unsigned long long>(index, w.count);
+        put<unsigned long long>(index, offset);
+        offset += (w.count * sizeof(Dtype) + kAlignment - 1) / kAlignment
+            * kAlignment;
+      }
+    }
+  }
+
+  //write next to fname and rename so concurrent readers never see a
+  //partial bundle
+  boost::filesystem::path tmp = boost::filesystem::unique_path(
+      fname + ".%%%%%%");
+  {
+    ofile out(tmp, std::ios::binary);
+    out.write(index.data(), index.size());
+    unsigned long long pos = index.size();
+    for (auto& item : models) {
+      for (const weight& w : item.second.weights) {
+        unsigned long long start = (pos + kAlignment - 1) / kAlignment
+            * kAlignment;
+        for (; pos < start; pos++)
+          out.put(0);
+        out.write((const char*) w.values.data(), w.count * sizeof(Dtype));
+        pos += w.count * sizeof(Dtype);
+      }
+    }
+    if (!out)
+      throw file_error(tmp, false);
+  }
+  boost::filesystem::rename(tmp, fname);
+}
@@ -0,0 +1,75 @@
+/*
+ * cnn_bundle.h
+ *
+ *  Precompiled bundle of CNN models.  Each model is stored as its upgraded,
+ *  batch norm folded graph (a binary NetParameter without weights) and its
+ *  weights as raw floats aligned to 64 bytes.  The file is memory mapped and
+ *  the weight blobs of a net point straight into the mapping, so loading a
+ *  model neither parses a text prototxt nor copies weights.  The layout is
+ *  native endian and meant to be read on the kind of machine that wrote it.
+ *  Every model records a hash of the model and weights it was built from so
+ *  a bundle left behind by a different build can be detected and rebuilt.
+ */
+
+#ifndef SMINA_CNN_BUNDLE_H
+#define SMINA_CNN_BUNDLE_H
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "caffe/net.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+class cnn_bundle {
+  public:
+    typedef float Dtype;
+
+    cnn_bundle() {}
+    //map fname; throws file_error if it can't be opened and usage_error
+    //if it isn't a bundle; a bundle of an older version has no models
+    explicit cnn_bundle(const std::string& fname);
+
+    bool has(const std::string& name) const {
+      return models.count(name) > 0;
+    }
+    //hash of the sources model name was built from, 0 if it isn't bundled
+    unsigned long long source(const std::string& name) const;
+    //64 bit FNV-1a hash of n bytes of data, continuing from h
+    static unsigned long long hash(const void *data, size_t n,
+        unsigned long long h = 14695981039346656037ULL);
+    //graph of model name, to be given runtime options and built into a net
+    void get_graph(const std::string& name, caffe::NetParameter& param) const;
+    //point the weights of net, built from the graph of name, into the mapping;
+    //the bundle must outlive net
+    void set_weights(const std::string& name, caffe::Net<Dtype>& net) const;
+
+    //add model name with graph (without weights) and the weights of net,
+    //built from sources with hash source
+    void add(const std::string& name, const caffe::NetParameter& graph,
+        const caffe::Net<Dtype>& net, unsigned long long source);
+    //write every added model to fname, atomically replacing it
+    void write(const std::string& fname) const;
+
+  private:
+    struct weight {
+        std::string layer;
+        unsigned index; //into the blobs of layer
+        unsigned long long count;
+        unsigned long long offset; //from the start of the file
+        std::vector<Dtype> values; //only set when writing
+    };
+
+    struct model_entry {
+        unsigned long long source;
+        std::string graph; //serialized NetParameter
+        std::vector<weight> weights;
+    };
+
+    boost::unordered_map<std::string, model_entry> models;
+    boost::shared_ptr<boost::iostreams::mapped_file> file;
+};
+
+#endif /* SMINA_CNN_BUNDLE_H */
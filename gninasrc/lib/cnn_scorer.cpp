@@ -11,12 +11,17 @@
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/layers/pooling_layer.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/upgrade_proto.hpp"
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/text_format.h>
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 
+#include "cnn_bundle.h"
 #include "cnn_data.h"
+#include "metrics.h"
+#include "parallel.h"
 
 using namespace caffe;
 using namespace std;
@@ -54,6 +59,349 @@ static void setup_mgridparm(caffe::MolGridDataParameter *mgridparam,
   mgridparam->set_random_translate(0);
 }
 
+//true if layer reads blob
+static bool reads_blob(const LayerParameter &layer, const string &blob)
+{
+  for (int i = 0, n = layer.bottom_size(); i < n; i++)
+    if (layer.bottom(i) == blob) return true;
+  return false;
+}
+
+//true if layer reads or writes blob
+static bool uses_blob(const LayerParameter &layer, const string &blob)
+{
+  if (reads_blob(layer, blob)) return true;
+  for (int i = 0, n = layer.top_size(); i < n; i++)
+    if (layer.top(i) == blob) return true;
+  return false;
+}
+
+//return the layer in weights named name, or NULL
+static LayerParameter* find_weights(NetParameter &weights, const string &name)
+{
+  for (int i = 0, n = weights.layer_size(); i < n; i++)
+    if (weights.layer(i).name() == name) return weights.mutable_layer(i);
+  return NULL;
+}
+
+//Simplify a network for inference by folding batch normalization, which
+//only applies stored per-channel statistics in the TEST phase, together with
+//the Scale layer that usually follows it into a single per-channel affine
+//transform.  If the batch norm input comes straight from a convolution that
+//nothing else reads before normalization (batch norm usually runs in place),
+//the transform is folded into the convolution's weights and bias and
+//disappears entirely; otherwise the pair is replaced by one
+//Scale layer, which avoids batch norm's copies and broadcast passes.
+//param is filtered to its phase and the folded parameters are written into
+//weights, which must be loaded into the net built from param.  The result is
+//numerically equivalent, including gradients with respect to the input.
+static void fold_batchnorm(NetParameter &param, NetParameter &weights)
+{
+  NetParameter filtered;
+  Net<CNNScorer::Dtype>::FilterNet(param, &filtered);
+
+  const int n = filtered.layer_size();
+  vector<bool> removed(n, false);
+  unsigned nfolded = 0;
+
+  for (int i = 0; i < n; i++)
+  {
+    const LayerParameter &bn = filtered.layer(i);
+    if (bn.type() != "BatchNorm" || bn.bottom_size() != 1
+        || bn.top_size() != 1)
+      continue;
+    if (bn.batch_norm_param().has_use_global_stats()
+        && !bn.batch_norm_param().use_global_stats())
+      continue;
+    LayerParameter *bnw = find_weights(weights, bn.name());
+    if (!bnw || bnw->blobs_size() != 3) continue;
+
+    const string &input = bn.bottom(0);
+    string output = bn.top(0);
+    //in place, later readers of input see the normalized values
+    bool inplace = output == input;
+
+    //per channel y = a*x+b
+    Blob<float> mean, var, factor;
+    mean.FromProto(bnw->blobs(0), true);
+    var.FromProto(bnw->blobs(1), true);
+    factor.FromProto(bnw->blobs(2), true);
+    const int channels = mean.count();
+    if (channels == 0 || var.count() != channels || factor.count() != 1)
+      continue;
+    float sf = factor.cpu_data()[0] == 0 ? 0 : 1 / factor.cpu_data()[0];
+    float eps = bn.batch_norm_param().eps();
+    vector<float> a(channels), b(channels);
+    for (int c = 0; c < channels; c++)
+    {
+      a[c] = 1.0 / sqrt(var.cpu_data()[c] * sf + eps);
+      b[c] = -mean.cpu_data()[c] * sf * a[c];
+    }
+
+    //absorb a following Scale that is the first reader of the output
+    int scalei = -1;
+    for (int j = i + 1; j < n; j++)
+    {
+      if (removed[j] || !reads_blob(filtered.layer(j), output)) continue;
+      const LayerParameter &sc = filtered.layer(j);
+      if (sc.type() != "Scale" || sc.bottom_size() != 1 || sc.top_size() != 1)
+        break;
+      const ScaleParameter &sp = sc.scale_param();
+      if (sp.axis() != 1 || sp.num_axes() != 1) break;
+      LayerParameter *scw = find_weights(weights, sc.name());
+      if (!scw || scw->blobs_size() < 1) break;
+      Blob<float> gamma, beta;
+      gamma.FromProto(scw->blobs(0), true);
+      if (gamma.count() != channels) break;
+      if (sp.bias_term())
+      {
+        if (scw->blobs_size() != 2) break;
+        beta.FromProto(scw->blobs(1), true);
+        if (beta.count() != channels) break;
+      }
+
+      const string &sctop = sc.top(0);
+      bool ok = true;
+      if (sctop != output)
+      {
+        //output only feeds this scale, and the scale's top isn't touched
+        //by anything we would be moving it in front of
+        for (int k = j + 1; k < n && ok; k++)
+          if (!removed[k] && reads_blob(filtered.layer(k), output)) ok = false;
+        for (int k = i + 1; k < j && ok; k++)
+          if (!removed[k] && uses_blob(filtered.layer(k), sctop)) ok = false;
+      }
+      if (!ok) break;
+
+      for (int c = 0; c < channels; c++)
+      {
+        float g = gamma.cpu_data()[c];
+        a[c] *= g;
+        b[c] = b[c] * g + (sp.bias_term() ? beta.cpu_data()[c] : 0);
+      }
+      scalei = j;
+      output = sctop;
+      break;
+    }
+
+    //find the convolution producing the input, if it is only read by us
+    int convi = -1;
+    for (int p = i - 1; p >= 0; p--)
+    {
+      if (removed[p]) continue;
+      const LayerParameter &prev = filtered.layer(p);
+      bool writes = false;
+      for (int t = 0, nt = prev.top_size(); t < nt; t++)
+        if (prev.top(t) == input) writes = true;
+      if (!writes)
+      {
+        if (uses_blob(prev, input) || uses_blob(prev, output)) break;
+        continue;
+      }
+      if (prev.type() == "Convolution" && prev.top_size() == 1
+          && !reads_blob(prev, input))
+        convi = p;
+      break;
+    }
+    if (convi >= 0 && !inplace)
+    {
+      for (int k = i + 1; k < n; k++)
+        if (!removed[k] && k != scalei && reads_blob(filtered.layer(k), input))
+          convi = -1;
+    }
+    LayerParameter *convw =
+        convi >= 0 ? find_weights(weights, filtered.layer(convi).name()) : NULL;
+
+    if (convw && convw->blobs_size() >= 1)
+    {
+      LayerParameter *conv = filtered.mutable_layer(convi);
+      ConvolutionParameter *cp = conv->mutable_convolution_param();
+      Blob<float> w, bias;
+      w.FromProto(convw->blobs(0), true);
+      if (w.shape(0) == channels)
+      {
+        int per = w.count() / channels;
+        float *wd = w.mutable_cpu_data();
+        for (int c = 0; c < channels; c++)
+          for (int k = 0; k < per; k++)
+            wd[c * per + k] *= a[c];
+
+        vector<int> bshape(1, channels);
+        bias.Reshape(bshape);
+        if (cp->bias_term() && convw->blobs_size() > 1)
+          bias.FromProto(convw->blobs(1), false);
+        else
+          caffe_set(channels, 0.0f, bias.mutable_cpu_data());
+        float *bd = bias.mutable_cpu_data();
+        for (int c = 0; c < channels; c++)
+          bd[c] = bd[c] * a[c] + b[c];
+        cp->set_bias_term(true);
+        w.ToProto(convw->mutable_blobs(0));
+        if (convw->blobs_size() < 2) convw->add_blobs();
+        bias.ToProto(convw->mutable_blobs(1));
+        conv->set_top(0, output);
+
+        removed[i] = true;
+        if (scalei >= 0) removed[scalei] = true;
+        nfolded++;
+        continue;
+      }
+    }
+
+    //replace with a single scale layer that has the batch norm's name
+    LayerParameter *layer = filtered.mutable_layer(i);
+    layer->clear_param();
+    layer->clear_batch_norm_param();
+    layer->set_type("Scale");
+    layer->set_top(0, output);
+    ScaleParameter *sp = layer->mutable_scale_param();
+    sp->set_axis(1);
+    sp->set_num_axes(1);
+    sp->set_bias_term(true);
+
+    Blob<float> scale, shift;
+    vector<int> shape(1, channels);
+    scale.Reshape(shape);
+    shift.Reshape(shape);
+    std::copy(a.begin(), a.end(), scale.mutable_cpu_data());
+    std::copy(b.begin(), b.end(), shift.mutable_cpu_data());
+    bnw->clear_blobs();
+    scale.ToProto(bnw->add_blobs());
+    shift.ToProto(bnw->add_blobs());
+
+    if (scalei >= 0) removed[scalei] = true;
+    nfolded++;
+  }
+
+  if (nfolded == 0) return;
+  param.CopyFrom(filtered);
+  param.clear_layer();
+  for (int i = 0; i < n; i++)
+  {
+    if (!removed[i]) param.add_layer()->CopyFrom(filtered.layer(i));
+  }
+}
+
+//molecular grids have many atom type channels that are entirely empty,
+//let the CPU convolution skip them
+static void skip_zero_channels(NetParameter &param)
+{
+  for (int i = 0, n = param.layer_size(); i < n; i++)
+  {
+    LayerParameter *layer = param.mutable_layer(i);
+    if (layer->type() == "Convolution")
+      layer->mutable_convolution_param()->set_skip_zero_channels(true);
+  }
+}
+
+//trade accuracy for cpu speed by multiplying in int8
+static void quantize_int8(NetParameter &param)
+{
+  for (int i = 0, n = param.layer_size(); i < n; i++)
+  {
+    LayerParameter *layer = param.mutable_layer(i);
+    if (layer->type() == "Convolution")
+      layer->mutable_convolution_param()->set_quantize_int8(true);
+    else if (layer->type() == "InnerProduct")
+      layer->mutable_inner_product_param()->set_quantize_int8(true);
+  }
+}
+
+//gnina only runs Forward and Backward and then reads the outputs and the
+//gradient of the input grid, so other blobs can share memory; without
+//gradients the nets are never run backward at all
+static void plan_memory(NetParameter &param, const cnn_options &opts)
+{
+  param.set_force_backward(!opts.inference_only);
+  if (opts.inference_only)
+    param.set_memory_plan(NetParameter::SHARE_ALL);
+  else if (opts.share_memory)
+    param.set_memory_plan(NetParameter::SHARE_DIFF);
+
+  for (int i = 0, n = param.layer_size(); i < n; i++)
+  {
+    const LayerParameter &layer = param.layer(i);
+    for (int t = 0, nt = layer.top_size(); t < nt; t++)
+    {
+      const string &top = layer.top(t);
+      if (top == "output" || top == "loss" || top == "predaff")
+        param.add_keep_blob(top);
+    }
+  }
+}
+
+//parse built-in model name into param, with folded batch norms if fold, and
+//its weights into wparam
+static void load_builtin(const string &name, NetParameter &param,
+    NetParameter &wparam, bool fold = true)
+{
+  const char *model = cnn_models[name].model;
+  google::protobuf::io::ArrayInputStream modeldata(model, strlen(model));
+  bool success = google::protobuf::TextFormat::Parse(&modeldata, &param);
+  if (!success)
+    throw usage_error(
+        "Error with built-in cnn model " + name);
+  UpgradeNetAsNeeded("default", &param);
+
+  param.mutable_state()->set_phase(TEST);
+
+  const unsigned char *weights = cnn_models[name].weights;
+  unsigned int nbytes = cnn_models[name].num_bytes;
+
+  google::protobuf::io::ArrayInputStream weightdata(weights, nbytes);
+  google::protobuf::io::CodedInputStream strm(&weightdata);
+  strm.SetTotalBytesLimit(INT_MAX, 536870912);
+  success = wparam.ParseFromCodedStream(&strm);
+  if (!success)
+    throw usage_error("Error with default weights.");
+
+  if (fold)
+    fold_batchnorm(param, wparam);
+}
+
+//hash of the embedded model and weights of built-in model name, never 0
+static unsigned long long builtin_source(const string &name)
+{
+  const cnn_model_def &def = cnn_models[name];
+  unsigned long long h = cnn_bundle::hash(def.model, strlen(def.model));
+  h = cnn_bundle::hash(def.weights, def.num_bytes, h);
+  return h ? h : 1;
+}
+
+//map the bundle of every built-in model in fname, building it first if it
+//doesn't exist yet or any of the built-in models in names has changed since
+static caffe::shared_ptr<cnn_bundle> open_bundle(const string &fname,
+    const vector<string> &names)
+{
+  if (boost::filesystem::exists(fname))
+  {
+    caffe::shared_ptr<cnn_bundle> b(new cnn_bundle(fname));
+    bool current = true;
+    for (const auto &name : names)
+    {
+      if (current && cnn_models.count(name))
+        current = b->source(name) == builtin_source(name);
+    }
+    if (current)
+      return b;
+  }
+
+  cnn_bundle b;
+  for (const auto &item : cnn_models)
+  {
+    NetParameter param, wparam;
+    load_builtin(item.first, param, wparam);
+    NetParameter netparam(param);
+    setup_mgridparm(netparam.mutable_layer(0)->mutable_molgrid_data_param(),
+        cnn_options(), item.first);
+    Net<CNNScorer::Dtype> net(netparam);
+    net.CopyTrainedLayersFrom(wparam);
+    b.add(item.first, param, net, builtin_source(item.first));
+  }
+  b.write(fname);
+  return caffe::shared_ptr<cnn_bundle>(new cnn_bundle(fname));
+}
+
 //initialize from commandline options
 //throw error if missing required info
 CNNScorer::CNNScorer(const cnn_options &opts) :
@@ -97,6 +445,9 @@ CNNScorer::CNNScorer(const cnn_options &opts) :
     }
   }
 
+  if (cnnopts.cnn_bundle_file.size() > 0)
+    bundle = open_bundle(cnnopts.cnn_bundle_file, model_names);
+
   //load built-in models
   for (const auto &name : model_names)
   {
@@ -106,38 +457,31 @@ CNNScorer::CNNScorer(const cnn_options &opts) :
       throw usage_error("Invalid model name: " + name);
     }
 
-    const char *model = cnn_models[name].model;
-    google::protobuf::io::ArrayInputStream modeldata(model, strlen(model));
-    bool success = google::protobuf::TextFormat::Parse(&modeldata, &param);
-    if (!success)
-      throw usage_error(
-          "Error with built-in cnn model " + name);
-    UpgradeNetAsNeeded("default", &param);
+    //load weights
+    NetParameter wparam;
+    bool inbundle = bundle && cnnopts.simplify_net && bundle->has(name);
+    if (inbundle)
+      bundle->get_graph(name, param);
+    else
+      load_builtin(name, param, wparam, cnnopts.simplify_net);
 
-    param.mutable_state()->set_phase(TEST);
+    if (cnnopts.simplify_net)
+      skip_zero_channels(param);
+    if (cnnopts.quantize_int8)
+      quantize_int8(param);
 
     LayerParameter *first = param.mutable_layer(0);
     mgridparams.push_back(first->mutable_molgrid_data_param());
     setup_mgridparm(mgridparams.back(), cnnopts, name);
 
-    param.set_force_backward(true);
+    plan_memory(param, cnnopts);
     auto net = caffe::shared_ptr<caffe::Net < Dtype> >(new Net<Dtype>(param));
     nets.push_back(net);
 
-    //load weights
-    NetParameter wparam;
-
-    const unsigned char *weights = cnn_models[name].weights;
-    unsigned int nbytes = cnn_models[name].num_bytes;
-
-    google::protobuf::io::ArrayInputStream weightdata(weights, nbytes);
-    google::protobuf::io::CodedInputStream strm(&weightdata);
-    strm.SetTotalBytesLimit(INT_MAX, 536870912);
-    success = wparam.ParseFromCodedStream(&strm);
-    if (!success)
-      throw usage_error("Error with default weights.");
-
-    net->CopyTrainedLayersFrom(wparam);
+    if (inbundle)
+      bundle->set_weights(name, *net);
+    else
+      net->CopyTrainedLayersFrom(wparam);
   }
 
   //load external models
@@ -149,14 +493,32 @@ CNNScorer::CNNScorer(const cnn_options &opts) :
 
     ReadNetParamsFromTextFileOrDie(mfile, &param);
     param.mutable_state()->set_phase(TEST);
+
+    //hdf5 weights are loaded as is, binary protos can be folded
+    NetParameter wparam;
+    bool binaryweights = !ends_with(wfile, ".h5");
+    if (binaryweights)
+    {
+      ReadNetParamsFromBinaryFileOrDie(wfile, &wparam);
+      if (cnnopts.simplify_net)
+        fold_batchnorm(param, wparam);
+    }
+    if (cnnopts.simplify_net)
+      skip_zero_channels(param);
+    if (cnnopts.quantize_int8)
+      quantize_int8(param);
+
     LayerParameter *first = param.mutable_layer(0);
     mgridparams.push_back(first->mutable_molgrid_data_param());
     setup_mgridparm(mgridparams.back(), cnnopts, "");
 
-    param.set_force_backward(true);
+    plan_memory(param, cnnopts);
     auto net = caffe::shared_ptr<caffe::Net < Dtype> >(new Net<Dtype>(param));
     nets.push_back(net);
-    net->CopyTrainedLayersFrom(wfile);
+    if (binaryweights)
+      net->CopyTrainedLayersFrom(wparam);
+    else
+      net->CopyTrainedLayersFrom(wfile);
   }
 
   //check that networks matches our expectations and set mgrids
@@ -173,6 +535,13 @@ CNNScorer::CNNScorer(const cnn_options &opts) :
     }
     mgrids.push_back(mgrid);
 
+    //weight gradients are never used, don't compute or allocate them
+    for (unsigned j = 0, nl = layers.size(); j < nl; j++)
+    {
+      for (unsigned k = 0, np = layers[j]->blobs().size(); k < np; k++)
+        layers[j]->set_param_propagate_down(k, false);
+    }
+
     //we also need an output layer
     if (layers.size() < 1)
     {
@@ -555,7 +924,8 @@ void CNNScorer::setReceptor(const model &m)
 }
 
 // Get ligand (and flexible receptor) gradient
-void CNNScorer::getGradient(caffe::MolGridDataLayer<Dtype> *mgrid)
+void CNNScorer::getGradient(caffe::MolGridDataLayer<Dtype> *mgrid,
+    std::vector<gfloat3> &gradient) const
 {
   gradient.reserve(ligand_coords.size() + num_flex_atoms);
 
@@ -577,6 +947,146 @@ void CNNScorer::getGradient(caffe::MolGridDataLayer<Dtype> *mgrid)
   CHECK_EQ(gradient.size(), ligand_coords.size() + num_flex_atoms);
 }
 
+//one job per ensemble member; threads are started once and reused for
+//every score call
+struct CNNScorer::ensemble_pool {
+    struct job {
+        CNNScorer *scorer;
+        const model *m;
+        bool compute_gradient;
+        vec center;
+        int threads_per_net; //caffe cpu threads for each member
+        std::vector<net_result> *results;
+
+        job()
+            : scorer(NULL), m(NULL), compute_gradient(false),
+                center(NAN, NAN, NAN), threads_per_net(1), results(NULL) {
+        }
+        void operator()(sz i) const {
+          caffe::Caffe::set_cpu_threads(threads_per_net);
+          scorer->evaluate_net(i, *m, compute_gradient, center, (*results)[i]);
+        }
+    };
+    //caffe state is per thread and defaults to the cpu
+    struct thread_init {
+        void operator()() const {
+          caffe::Caffe::set_mode(caffe::Caffe::CPU);
+        }
+    };
+
+    job j;
+    parallel_for<job, thread_init, true> pf;
+
+    ensemble_pool(sz nthreads)
+        : pf(&j, nthreads, thread_init()) {
+    }
+};
+
+//networks are independent, so when running on the cpu with cores to spare
+//evaluate them at the same time; the debugging outputs assume one network
+//at a time and the gpu is already saturated by a single network
+bool CNNScorer::evaluate_concurrently() const
+{
+  return nets.size() > 1 && caffe::Caffe::mode() == caffe::Caffe::CPU
+      && caffe::Caffe::cpu_threads() > 1 && !cnnopts.outputxyz
+      && !cnnopts.outputdx && !cnnopts.gradient_check && !cnnopts.verbose;
+}
+
+void CNNScorer::evaluate_net(unsigned i, const model &m, bool compute_gradient,
+    const vec &center, net_result &r)
+{
+  caffe::Caffe::set_random_seed(cnnopts.seed); //same random rotations for each ligand..
+  auto net = nets[i];
+  auto mgrid = mgrids[i];
+  r = net_result();
+  r.center = center;
+
+  if (!isnan(cnnopts.cnn_center[0]))
+  {
+    mgrid->setGridCenter(cnnopts.cnn_center);
+    r.center = mgrid->getGridCenter();
+  }
+  else if (!isnan(center[0]))
+  {
+    mgrid->setGridCenter(center);
+  }
+
+  mgrid->setLigand(ligand_coords, ligand_smtypes, cnnopts.move_minimize_frame);
+
+  if (!cnnopts.move_minimize_frame)
+  { //if fixed_receptor, rec_conf will be identify
+    mgrid->setReceptor(receptor_coords, receptor_smtypes, m.rec_conf.position,
+        m.rec_conf.orientation);
+  }
+  else
+  { //don't move receptor
+    mgrid->setReceptor(receptor_coords, receptor_smtypes);
+    r.center = mgrid->getGridCenter(); //has been recalculated from ligand
+    if (cnnopts.verbose)
+    {
+      std::cout << "current center: ";
+      r.center.print(std::cout);
+      std::cout << "\n";
+    }
+  }
+
+  if (compute_gradient || cnnopts.outputxyz)
+  {
+    mgrid->enableLigandGradients();
+    if (cnnopts.moving_receptor() || cnnopts.outputxyz)
+    {
+      mgrid->enableReceptorGradients();
+    }
+    else if (num_flex_atoms != 0)
+    {
+      mgrid->enableReceptorGradients(); // rmeli: TODO flexres gradients only
+    }
+  }
+
+  mgrid->setLabels(1); //for now pose optimization only
+  for (unsigned rot = 0, n = max(cnnopts.cnn_rotations, 1U); rot < n; rot++)
+  {
+    Dtype s = 0, a = 0, l = 0;
+    {
+      metric_timer timer(MetricCNNForward);
+      net->Forward(); //do all rotations at once if requested
+    }
+
+    get_net_output(net, s, a, l);
+    r.score += s;
+    r.affinities.push_back(a);
+    r.affinity += a;
+    r.loss += l;
+
+    if (cnnopts.cnn_rotations > 1)
+    {
+      if (cnnopts.verbose) {
+        std::cout << "RotateScore: " << s << "\n";
+        if (a)
+          std::cout << "RotateAff: " << a << "\n";
+      }
+    }
+
+    if (compute_gradient || cnnopts.outputxyz)
+    {
+      CHECK(!cnnopts.inference_only) << "Gradient of inference only CNN";
+      {
+        metric_timer timer(MetricCNNBackward);
+        net->Backward();
+      }
+      // Get ligand (and flexible residues) gradient from mgrid
+      r.gradients.push_back(vector<gfloat3>());
+      getGradient(mgrid, r.gradients.back());
+
+      // Gradient for rigid receptor transformation: translation and torque
+      if (cnnopts.moving_receptor())
+        mgrid->getReceptorTransformationGradient(0, r.rec_force,
+            r.rec_torque);
+    }
+    r.cnt++;
+  } //end rotations
+}
+
 //return score of model, assumes receptor has not changed from initialization
 //also sets affinity (if available) and loss (for use with minimization)
 //if compute_gradient is set, also adds cnn atom gradient to m.minus_forces
@@ -611,110 +1121,66 @@ float CNNScorer::score(model &m, bool compute_gradient, float &affinity,
   unsigned nscores = nets.size()*max(cnnopts.cnn_rotations, 1U);
   vector<float> affinities;
   if(nscores > 1) affinities.reserve(nscores);
-  for(unsigned i = 0, n = nets.size(); i < n; i++) {
-    caffe::Caffe::set_random_seed(cnnopts.seed); //same random rotations for each ligand..
-    auto net = nets[i];
-    auto mgrid = mgrids[i];
-
-    if (!isnan(cnnopts.cnn_center[0]))
-    {
-      mgrid->setGridCenter(cnnopts.cnn_center);
-      current_center = mgrid->getGridCenter();
-    }
-    else if (!isnan(current_center[0]))
-    {
-      mgrid->setGridCenter(current_center);
-    }
-
-    mgrid->setLigand(ligand_coords, ligand_smtypes, cnnopts.move_minimize_frame);
 
-    if (!cnnopts.move_minimize_frame)
-    { //if fixed_receptor, rec_conf will be identify
-      mgrid->setReceptor(receptor_coords, receptor_smtypes, m.rec_conf.position,
-          m.rec_conf.orientation);
-    }
-    else
-    { //don't move receptor
-      mgrid->setReceptor(receptor_coords, receptor_smtypes);
-      current_center = mgrid->getGridCenter(); //has been recalculated from ligand
-      if (cnnopts.verbose)
-      {
-        std::cout << "current center: ";
-        current_center.print(std::cout);
-        std::cout << "\n";
-      }
-    }
+  vector<net_result> results(nets.size());
+  bool concurrent = evaluate_concurrently();
+  if (concurrent)
+  {
+    int nthreads = caffe::Caffe::cpu_threads();
+    if (!pool)
+      pool.reset(new ensemble_pool(min<sz>(nets.size(), nthreads)));
+    pool->j.scorer = this;
+    pool->j.m = &m;
+    pool->j.compute_gradient = compute_gradient;
+    pool->j.center = current_center;
+    pool->j.threads_per_net = max(1, nthreads / (int) nets.size());
+    pool->j.results = &results;
+    pool->pf.run(nets.size());
+  }
 
-    if (compute_gradient || cnnopts.outputxyz)
+  //combine in network order so the result does not depend on which
+  //network finished first
+  for(unsigned i = 0, n = nets.size(); i < n; i++) {
+    net_result& r = results[i];
+    if (!concurrent)
+      evaluate_net(i, m, compute_gradient, current_center, r);
+    current_center = r.center;
+
+    score += r.score;
+    affinity += r.affinity;
+    loss += r.loss;
+    cnt += r.cnt;
+    if(nscores > 1)
+      affinities.insert(affinities.end(), r.affinities.begin(), r.affinities.end());
+
+    // Update ligand (and flexible residues) gradient
+    for (unsigned g = 0, ng = r.gradients.size(); g < ng; g++)
+      m.add_minus_forces(r.gradients[g]);
+    if ((compute_gradient || cnnopts.outputxyz) && cnnopts.moving_receptor())
     {
-      mgrid->enableLigandGradients();
-      if (cnnopts.moving_receptor() || cnnopts.outputxyz)
-      {
-        mgrid->enableReceptorGradients();
-      }
-      else if (num_flex_atoms != 0)
-      {
-        mgrid->enableReceptorGradients(); // rmeli: TODO flexres gradients only
-      }
+      m.rec_change.position = r.rec_force;
+      m.rec_change.orientation = r.rec_torque;
     }
 
-    mgrid->setLabels(1); //for now pose optimization only
-    for (unsigned r = 0, n = max(cnnopts.cnn_rotations, 1U); r < n; r++)
-    {
-      Dtype s = 0, a = 0, l = 0;
-      net->Forward(); //do all rotations at once if requested
-
-      get_net_output(net, s, a, l);
-      score += s;
-      if(nscores > 1) affinities.push_back(a);
-      affinity += a;
-      loss += l;
-
-      if (cnnopts.cnn_rotations > 1)
-      {
-        if (cnnopts.verbose) {
-          std::cout << "RotateScore: " << s << "\n";
-          if (a)
-            std::cout << "RotateAff: " << a << "\n";
-        }
-      }
-
-      if (compute_gradient || cnnopts.outputxyz)
-      {
-        net->Backward();
-        // Get gradient from mgrid into CNNScorer::gradient
-        getGradient(mgrid);
-
-        // Update ligand (and flexible residues) gradient
-        m.add_minus_forces(gradient);
-
-        // Gradient for rigid receptor transformation: translation and torque
-        if (cnnopts.moving_receptor())
-          mgrid->getReceptorTransformationGradient(0, m.rec_change.position,
-              m.rec_change.orientation);
-      }
-      cnt++;
-    } //end rotations
-
     if (cnnopts.outputxyz)
     {
       const string &ligname = cnnopts.xyzprefix + "_lig.xyz";
       const string &recname = cnnopts.xyzprefix + "_rec.xyz";
 
-      mgrid->getLigandGradient(0, gradient);
-      mgrid->getLigandAtoms(0, atoms);
-      mgrid->getLigandChannels(0, channels);
+      mgrids[i]->getLigandGradient(0, gradient);
+      mgrids[i]->getLigandAtoms(0, atoms);
+      mgrids[i]->getLigandChannels(0, channels);
       outputXYZ(ligname, atoms, channels, gradient);
 
-      mgrid->getReceptorGradient(0, gradient); // rmeli: TODO Full gradient or just flexres?
-      mgrid->getReceptorAtoms(0, atoms);
-      mgrid->getReceptorChannels(0, channels);
+      mgrids[i]->getReceptorGradient(0, gradient); // rmeli: TODO Full gradient or just flexres?
+      mgrids[i]->getReceptorAtoms(0, atoms);
+      mgrids[i]->getReceptorChannels(0, channels);
       outputXYZ(recname, atoms, channels, gradient);
     }
 
     if (cnnopts.gradient_check)
     {
-      check_gradient(net);
+      check_gradient(nets[i]);
     }
 
     if (cnnopts.outputdx && i == 0)
@@ -17,6 +17,7 @@
 #include <vector>
 
 #include "model.h"
+#include "cnn_bundle.h"
 #include "cnn_data.h"
 
 /* This class evaluates protein-ligand poses according to a provided
@@ -34,6 +35,26 @@ class CNNScorer {
 
     caffe::shared_ptr<boost::recursive_mutex> mtx; //todo, enable parallel scoring
 
+    //precompiled models, the weights of nets may point into its mapping
+    caffe::shared_ptr<cnn_bundle> bundle;
+
+    //threads that evaluate ensemble members concurrently, shared by copies
+    struct ensemble_pool;
+    caffe::shared_ptr<ensemble_pool> pool;
+
+    //what one network contributes to a score, kept separate so networks can
+    //be evaluated on different threads and combined in network order
+    struct net_result {
+        double score = 0;
+        double affinity = 0;
+        double loss = 0;
+        unsigned cnt = 0;
+        std::vector<float> affinities; //per rotation
+        std::vector<std::vector<gfloat3> > gradients; //per rotation
+        vec rec_force, rec_torque; //of the last rotation
+        vec center;
+    };
+
     //scratch vectors to avoid memory reallocation
     std::vector<gfloat3> gradient;
     std::vector<gfloat3> atoms;
@@ -50,7 +71,13 @@ class CNNScorer {
     void setLigand(const model& m);
     void setReceptor(const model& m);
 
-    void getGradient(caffe::MolGridDataLayer<Dtype> *mgrid);
+    void getGradient(caffe::MolGridDataLayer<Dtype> *mgrid, std::vector<gfloat3>& gradient) const;
+
+    //run network i on the current ligand and receptor, touching no state
+    //shared with the other networks
+    void evaluate_net(unsigned i, const model& m, bool compute_gradient,
+        const vec& center, net_result& r);
+    bool evaluate_concurrently() const;
 
   public:
     CNNScorer()
@@ -517,6 +517,22 @@ struct conf {
     }
 };
 
+//the single entity of a conf changed by a monte carlo mutation
+struct conf_mutation {
+    enum kind_t {
+      None, Position, Orientation, LigandTorsion, FlexTorsion
+    };
+    kind_t kind;
+    sz index; //of the ligand or flexible residue
+    sz torsion; //index into its torsions, for torsion mutations
+    conf_mutation()
+        : kind(None), index(0), torsion(0) {
+    }
+    conf_mutation(kind_t k, sz i, sz t = 0)
+        : kind(k), index(i), torsion(t) {
+    }
+};
+
 struct output_type {
     conf c;
     fl e;
@@ -30,6 +30,7 @@
 #include <boost/iostreams/stream.hpp>
 #include <boost/iostreams/device/null.hpp>
 #include "common.h"
+#include "bgzf.h"
 
 struct file_error {
     path name;
@@ -61,6 +62,25 @@ struct ofile : public boost::filesystem::ofstream { // never use ofstream pointe
     }
 };
 
+//open name for writing with the extra flags in mode; if resume_at is not
+//negative the existing file is cut to that size and appended to
+inline void open_output(std::ofstream& out, const path& name,
+    std::streamoff resume_at = -1,
+    std::ios_base::openmode mode = std::ios_base::openmode()) {
+  using namespace boost::filesystem;
+  if (resume_at >= 0) {
+    if (!exists(name) && resume_at == 0)
+      ofile create(name); //nothing was written yet
+    if (!exists(name) || std::streamoff(file_size(name)) < resume_at)
+      throw file_error(name, false);
+    resize_file(name, resume_at);
+    out.open(name.c_str(), std::ios::in | std::ios::out | mode);
+    out.seekp(0, std::ios::end);
+  } else
+    out.open(name.c_str(), std::ios::out | mode);
+  if (!out) throw file_error(name, false);
+}
+
 //dkoes - wrapper for an input file that is optionally gzipped
 //name ends in .gz
 class izfile : public boost::iostreams::filtering_stream<boost::iostreams::input> {
@@ -78,9 +98,10 @@ class izfile : public boost::iostreams::filtering_stream<boost::iostreams::input
     }
 
     //opens file name, but only if it has the appropriate ext
-    //otherwise returns false
+    //otherwise returns false; blocked gzip is decompressed by threads
+    //threads (0 for one per core)
     bool open(const path& name, const std::string& ext, bool is_compressed =
-        false) {
+        false, unsigned threads = 0) {
       using namespace boost::filesystem;
       iszipped = is_compressed;
       //clean up if we are already open
@@ -96,12 +117,17 @@ class izfile : public boost::iostreams::filtering_stream<boost::iostreams::input
 
       if (fileext != ext) return false; //wrong type of file
 
-      uncompressed_infile.open(name.c_str());
+      uncompressed_infile.open(name.c_str(), std::ios::in | std::ios::binary);
 
-      if (iszipped) {
-        push(boost::iostreams::gzip_decompressor());
+      if (iszipped && is_bgzf(uncompressed_infile)) {
+        //blocked gzip can be decompressed in parallel
+        push(bgzf_decompressor(uncompressed_infile, threads));
+      } else {
+        if (iszipped) {
+          push(boost::iostreams::gzip_decompressor());
+        }
+        push(uncompressed_infile);
       }
-      push(uncompressed_infile);
 
       if (!uncompressed_infile || !*this) {
         throw file_error(path(name), true);
@@ -118,7 +144,7 @@ class izfile : public boost::iostreams::filtering_stream<boost::iostreams::input
 };
 
 //dkoes - wrapper for an output file that will be gzipped if the file
-//name ends in .gz
+//name ends in .gz; blocked gzip is used so compression is done in parallel
 class ozfile : public boost::iostreams::filtering_stream<
     boost::iostreams::output> {
 
@@ -133,23 +159,35 @@ class ozfile : public boost::iostreams::filtering_stream<
     }
 
     //opens file name, with gzip filter if name ends with .gz
+    //if resume_at is not negative the existing file is cut to that size
+    //and appended to, which for gzip must be a point at which it was flushed
+    //gzip is compressed by threads threads (0 for one per core)
     //return non-gz extension
-    std::string open(const path& name) {
+    std::string open(const path& name, std::streamoff resume_at = -1,
+        unsigned threads = 0) {
       using namespace boost::filesystem;
-      uncompressed_outfile.open(name.c_str());
-      if (!uncompressed_outfile) throw file_error(name, false);
+      open_output(uncompressed_outfile, name, resume_at, std::ios::binary);
 
       std::string ext = boost::filesystem::extension(name);
       //should we gzip?
       if (ext == ".gz") {
         ext = extension(basename(name));
-        push(boost::iostreams::gzip_compressor());
+        push(bgzf_compressor(uncompressed_outfile, threads));
+      } else {
+        push(uncompressed_outfile);
       }
-      push(uncompressed_outfile);
       if (!(*this)) throw file_error(name, false);
       return ext;
     }
 
+    //flush everything written so far through to the file and return its
+    //size, 0 if not open
+    std::streamoff tell() {
+      if (empty()) return 0;
+      flush();
+      return uncompressed_outfile.tellp();
+    }
+
     virtual ~ozfile() {
       //must remove streams before deallocating
       while (!empty())
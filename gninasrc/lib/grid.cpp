@@ -20,6 +20,7 @@
 
  */
 #include <string>
+#include <algorithm>
 #include "grid.h"
 #include "grid_dim.h"
 #include "common.h"
@@ -27,16 +28,26 @@
 //evaluate using grid, if deriv is null, do not calc deriviative
 fl grid::evaluate(const atom& a, const vec& location, fl slope, fl c,
     vec *deriv /*=NULL*/) const {
+  if (compacted())
+    return evaluate_data(data16, chargedata16, a, location, slope, c, deriv);
+  return evaluate_data(data, chargedata, a, location, slope, c, deriv);
+}
+
+template<typename T>
+fl grid::evaluate_data(const array3d<T>& m_data,
+    const array3d<T>& m_chargedata, const atom& a, const vec& location,
+    fl slope, fl c, vec *deriv) const {
   //charge indep
-  fl ret = evaluate_aux(data, location, slope, c, deriv);
-  if (a.charge != 0 && chargedata.dim0() > 0) {
+  fl ret = evaluate_aux(m_data, location, slope, c, deriv);
+  if (a.charge != 0 && m_chargedata.dim0() > 0) {
     //charge dependent
     if (deriv == NULL) {
-      ret += a.charge * evaluate_aux(chargedata, location, slope, c, NULL);
+      ret += a.charge * evaluate_aux(m_chargedata, location, slope, c, NULL);
     } else //otherwise, must add derivatives
     {
       vec cderiv(0, 0, 0);
-      ret += a.charge * evaluate_aux(chargedata, location, slope, c, &cderiv);
+      ret += a.charge
+          * evaluate_aux(m_chargedata, location, slope, c, &cderiv);
       *deriv += a.charge * cderiv;
     }
   }
@@ -49,16 +60,21 @@ fl grid::evaluate_user(const vec& location, fl slope, vec *deriv) const {
 
 //allocate memory for grid (but don't fill in values)
 //only initialize charge dependent values if hashcharged is true
-void grid::init(const grid_dims& gd, bool hascharged) {
-  data.resize(gd[0].n + 1, gd[1].n + 1, gd[2].n + 1);
-  if (hascharged) chargedata.resize(gd[0].n + 1, gd[1].n + 1, gd[2].n + 1);
+void grid::init(const grid_dims& gd, bool hascharged, bool compact) {
+  if (compact) {
+    data16.resize(gd[0].n + 1, gd[1].n + 1, gd[2].n + 1);
+    if (hascharged)
+      chargedata16.resize(gd[0].n + 1, gd[1].n + 1, gd[2].n + 1);
+  } else {
+    data.resize(gd[0].n + 1, gd[1].n + 1, gd[2].n + 1);
+    if (hascharged) chargedata.resize(gd[0].n + 1, gd[1].n + 1, gd[2].n + 1);
+  }
   m_init = vec(gd[0].begin, gd[1].begin, gd[2].begin);
   m_range = vec(gd[0].span(), gd[1].span(), gd[2].span());
   assert(m_range[0] > 0);
   assert(m_range[1] > 0);
   assert(m_range[2] > 0);
-  m_dim_fl_minus_1 = vec(data.dim0() - 1.0, data.dim1() - 1.0,
-      data.dim2() - 1.0);
+  m_dim_fl_minus_1 = vec(fl(gd[0].n), fl(gd[1].n), fl(gd[2].n));
   VINA_FOR(i, 3) {
     m_factor[i] = m_dim_fl_minus_1[i] / m_range[i];
     m_factor_inv[i] = 1 / m_factor[i];
@@ -92,7 +108,8 @@ void grid::init(const grid_dims& gd, std::istream& user_in,
   }
 }
 
-fl grid::evaluate_aux(const array3d<fl>& m_data, const vec& location, fl slope,
+template<typename T>
+fl grid::evaluate_aux(const array3d<T>& m_data, const vec& location, fl slope,
     fl v, vec* deriv) const { // sets *deriv if not NULL
   vec s = elementwise_product(location - m_init, m_factor);
 
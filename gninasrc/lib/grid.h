@@ -28,6 +28,7 @@
 #include "curl.h"
 #include "result_components.h"
 #include "atom.h"
+#include "bfloat16.h"
 
 class grid { // FIXME rm 'm_', consistent with my new style
     vec m_init;
@@ -37,6 +38,8 @@ class grid { // FIXME rm 'm_', consistent with my new style
     vec m_factor_inv;
     array3d<fl> data;
     array3d<fl> chargedata; //needs to be multiplied by atom charge
+    array3d<bfloat16> data16; //data and chargedata if compact
+    array3d<bfloat16> chargedata16;
 
     friend class cache;
     friend class non_cache;
@@ -49,20 +52,31 @@ class grid { // FIXME rm 'm_', consistent with my new style
     grid(const grid_dims& gd, bool hascharged) {
       init(gd, hascharged);
     }
-    void init(const grid_dims& gd, bool hascharged);
+    //if compact the values are stored as bfloat16, halving their memory;
+    //the grid can only be evaluated on the cpu then
+    void init(const grid_dims& gd, bool hascharged, bool compact = false);
     void init(const grid_dims& gd, std::istream& user_in, fl ug_scaling_factor);
     vec index_to_argument(sz x, sz y, sz z) const {
       return vec(m_init[0] + m_factor_inv[0] * x,
           m_init[1] + m_factor_inv[1] * y, m_init[2] + m_factor_inv[2] * z);
     }
     bool initialized() const {
-      return data.dim0() > 0 && data.dim1() > 0 && data.dim2() > 0;
+      return (data.dim0() > 0 && data.dim1() > 0 && data.dim2() > 0)
+          || compacted();
+    }
+    bool compacted() const {
+      return data16.dim0() > 0;
     }
     fl evaluate(const atom& a, const vec& location, fl slope, fl c, vec* deriv =
         NULL) const;
     fl evaluate_user(const vec& location, fl slope, vec* deriv = NULL) const;
   private:
-    fl evaluate_aux(const array3d<fl>& m_data, const vec& location, fl slope,
+    //the values are either data and chargedata or data16 and chargedata16
+    template<typename T>
+    fl evaluate_data(const array3d<T>& m_data, const array3d<T>& m_chargedata,
+        const atom& a, const vec& location, fl slope, fl c, vec* deriv) const;
+    template<typename T>
+    fl evaluate_aux(const array3d<T>& m_data, const vec& location, fl slope,
         fl v, vec* deriv) const; // sets *deriv if not NULL
     friend class boost::serialization::access;
     template<class Archive>
@@ -70,6 +84,8 @@ class grid { // FIXME rm 'm_', consistent with my new style
       ar & m_init;
       ar & data;
       ar & chargedata;
+      ar & data16;
+      ar & chargedata16;
       ar & m_range;
       ar & m_factor;
       ar & m_dim_fl_minus_1;
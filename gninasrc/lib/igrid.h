@@ -35,6 +35,14 @@ struct igrid { // grids interface (that cache, etc. conform to)
     virtual bool skip_interacting_pairs() const {
       return false;
     } //if true, evaluates the entire model, not just PL interactions
+    virtual bool can_eval_atom() const {
+      return false;
+    } //if true, eval sums eval_atom over the movable atoms
+    virtual fl eval_atom(const model& m, sz i, const vec& coords,
+        fl v) const {
+      VINA_CHECK(false);
+      return 0;
+    } //energy of movable atom i of m if it were at coords
     virtual void adjust_center(model& m) {
     } //for cnn
     virtual vec get_center() const {
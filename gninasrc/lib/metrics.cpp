@@ -0,0 +1,82 @@
+/*
+ * metrics.cpp
+ */
+
+#include "metrics.h"
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+namespace metrics {
+
+bool enabled_flag = false;
+
+static const char *stage_names[NumMetricStages] = { "read", "receptor_setup",
+    "grid_populate", "monte_carlo", "bfgs", "bfgs_eval", "refine",
+    "cnn_forward", "cnn_backward", "output" };
+
+struct thread_counters {
+    long long wall_ns[NumMetricStages];
+    long long cpu_ns[NumMetricStages];
+    unsigned long long calls[NumMetricStages];
+
+    thread_counters() {
+      for (unsigned i = 0; i < NumMetricStages; i++) {
+        wall_ns[i] = cpu_ns[i] = 0;
+        calls[i] = 0;
+      }
+    }
+};
+
+//counters of every thread that has recorded anything, kept after the thread
+//exits so they are included in the report
+static boost::mutex all_lock;
+static std::vector<thread_counters*> all_counters;
+static long long start_wall = 0;
+
+static thread_counters* local_counters() {
+  static thread_local thread_counters* local = NULL;
+  if (!local) {
+    local = new thread_counters();
+    boost::mutex::scoped_lock lk(all_lock);
+    all_counters.push_back(local);
+  }
+  return local;
+}
+
+void enable(bool on) {
+  enabled_flag = on;
+  start_wall = wall_now();
+}
+
+void record(metric_stage stage, long long wall_ns, long long cpu_ns) {
+  thread_counters *c = local_counters();
+  c->wall_ns[stage] += wall_ns;
+  c->cpu_ns[stage] += cpu_ns;
+  c->calls[stage]++;
+}
+
+void write_json(std::ostream& out) {
+  boost::mutex::scoped_lock lk(all_lock);
+  out << "{\n";
+  out << "  \"wall_seconds\": " << (wall_now() - start_wall) / 1e9 << ",\n";
+  out << "  \"stages\": {\n";
+  for (unsigned s = 0; s < NumMetricStages; s++) {
+    long long wall = 0, cpu = 0;
+    unsigned long long calls = 0;
+    unsigned threads = 0;
+    for (unsigned t = 0, n = all_counters.size(); t < n; t++) {
+      wall += all_counters[t]->wall_ns[s];
+      cpu += all_counters[t]->cpu_ns[s];
+      calls += all_counters[t]->calls[s];
+      if (all_counters[t]->calls[s]) threads++;
+    }
+    out << "    \"" << stage_names[s] << "\": { \"calls\": " << calls
+        << ", \"wall_seconds\": " << wall / 1e9 << ", \"cpu_seconds\": "
+        << cpu / 1e9 << ", \"threads\": " << threads << " }"
+        << (s + 1 < NumMetricStages ? "," : "") << "\n";
+  }
+  out << "  }\n";
+  out << "}\n";
+}
+
+}
@@ -0,0 +1,83 @@
+/*
+ * metrics.h
+ *
+ *  Low overhead per-stage timing and call counts.  Each thread accumulates
+ *  into its own counters, which are only combined when reported, so timing
+ *  a stage costs two clock reads and never takes a lock.  When metrics are
+ *  not enabled a timer is a single branch.
+ */
+
+#ifndef SMINA_METRICS_H
+#define SMINA_METRICS_H
+
+#include <ostream>
+#include <time.h>
+
+//stages of a run that are timed
+enum metric_stage {
+  MetricRead, //reading and parsing ligands
+  MetricReceptorSetup, //reading and preparing the receptor
+  MetricGridPopulate, //cache::populate
+  MetricMonteCarlo, //one monte carlo chain (includes its minimizations)
+  MetricBFGS, //one minimization
+  MetricBFGSEval, //one energy and gradient evaluation during minimization
+  MetricRefine, //refinement of a final pose
+  MetricCNNForward, //CNN forward pass
+  MetricCNNBackward, //CNN backward pass
+  MetricOutput, //writing results
+  NumMetricStages
+};
+
+namespace metrics {
+
+//must be called before any worker threads are started
+void enable(bool on = true);
+
+extern bool enabled_flag;
+inline bool enabled() {
+  return enabled_flag;
+}
+
+//add one call of stage taking wall and cpu nanoseconds to this thread's counters
+void record(metric_stage stage, long long wall_ns, long long cpu_ns);
+
+//write totals over all threads as a JSON object
+void write_json(std::ostream& out);
+
+inline long long wall_now() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+inline long long cpu_now() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+}
+
+//times the enclosing scope as one call of stage
+class metric_timer {
+    metric_stage stage;
+    bool active;
+    long long wall_start;
+    long long cpu_start;
+  public:
+    metric_timer(metric_stage s)
+        : stage(s), active(metrics::enabled()), wall_start(0), cpu_start(0) {
+      if (active) {
+        wall_start = metrics::wall_now();
+        cpu_start = metrics::cpu_now();
+      }
+    }
+
+    ~metric_timer() {
+      if (active)
+        metrics::record(stage, metrics::wall_now() - wall_start,
+            metrics::cpu_now() - cpu_start);
+    }
+};
+
+#endif /* SMINA_METRICS_H */
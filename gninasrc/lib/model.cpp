@@ -928,6 +928,81 @@ void model::set(const conf& c) {
   rec_conf = c.receptor;
 }
 
+//append the atom ranges of every node in b and below
+static void branches_ranges(const branches& b, std::vector<atom_range>& out) {
+  VINA_FOR_IN(i, b) {
+    out.push_back(b[i].node);
+    branches_ranges(b[i].children, out);
+  }
+}
+
+template<typename T>
+static void tree_ranges(const heterotree<T>& t, std::vector<atom_range>& out) {
+  out.push_back(t.node);
+  branches_ranges(t.children, out);
+}
+
+//find the which'th branch under b in the order set_conf consumes torsions,
+//setting parent to the frame it hangs from
+static branch* find_torsion_branch(branches& b, const frame& parent, sz& which,
+    const frame*& branch_parent) {
+  VINA_FOR_IN(i, b) {
+    if (which == 0) {
+      branch_parent = &parent;
+      return &b[i];
+    }
+    --which;
+    branch *ret = find_torsion_branch(b[i].children, b[i].node, which,
+        branch_parent);
+    if (ret) return ret;
+  }
+  return NULL;
+}
+
+//set the which'th branch under t and its subtree from the torsions at p
+template<typename T>
+static void set_torsion_branch(heterotree<T>& t, sz which,
+    flv::const_iterator p, const atomv& atoms, vecv& coords,
+    std::vector<atom_range>& moved) {
+  const frame *parent = NULL;
+  branch *b = find_torsion_branch(t.children, t.node, which, parent);
+  VINA_CHECK(b && parent);
+  b->set_conf(*parent, atoms, coords, p);
+  moved.push_back(b->node);
+  branches_ranges(b->children, moved);
+}
+
+//the frames of the unchanged nodes are exactly as the last set left them,
+//so recomputing from them gives the same coords as a full set
+void model::set_mutated(const conf& c, const conf_mutation& mut,
+    std::vector<atom_range>& moved) {
+  moved.clear();
+  switch (mut.kind) {
+  case conf_mutation::None:
+    break;
+  case conf_mutation::Position:
+  case conf_mutation::Orientation:
+    ligands[mut.index].set_conf(atoms, coords, c.ligands[mut.index]);
+    tree_ranges(ligands[mut.index], moved);
+    break;
+  case conf_mutation::LigandTorsion:
+    set_torsion_branch(ligands[mut.index], mut.torsion,
+        c.ligands[mut.index].torsions.begin() + mut.torsion, atoms, coords,
+        moved);
+    break;
+  case conf_mutation::FlexTorsion:
+    if (mut.torsion == 0) { //the first segment carries the whole residue
+      flex[mut.index].set_conf(atoms, coords, c.flex[mut.index]);
+      tree_ranges(flex[mut.index], moved);
+    } else //the first segment's torsion comes before those of the branches
+      set_torsion_branch(flex[mut.index], mut.torsion - 1,
+          c.flex[mut.index].torsions.begin() + mut.torsion, atoms, coords,
+          moved);
+    break;
+  }
+  rec_conf = c.receptor;
+}
+
 //dkoes - return the string corresponding to i'th ligand atoms pdb information
 //which is serial+name
 std::string model::ligand_atom_str(sz i, sz lig) const {
@@ -401,6 +401,57 @@ fl model::eval_adjusted(const scoring_function& sf, const precalculate& p,
   return sf.conf_independent(*this, e - intramolecular_energy);
 }
 
+fl model::eval_moved_pairs(const precalculate& p, fl v,
+    const interacting_pairs& pairs, const vecv& old_coords,
+    const std::vector<bool>& moved) const {
+  const fl cutoff_sqr = p.cutoff_sqr();
+  fl e = 0;
+  VINA_FOR_IN(i, pairs) {
+    const interacting_pair& ip = pairs[i];
+    if (moved[ip.a] == moved[ip.b]) continue; //distance is unchanged
+    fl r2 = vec_distance_sqr(coords[ip.a], coords[ip.b]);
+    if (r2 < cutoff_sqr) {
+      fl tmp = p.eval(atoms[ip.a], atoms[ip.b], r2);
+      curl(tmp, v);
+      e += tmp;
+    }
+    r2 = vec_distance_sqr(old_coords[ip.a], old_coords[ip.b]);
+    if (r2 < cutoff_sqr) {
+      fl tmp = p.eval(atoms[ip.a], atoms[ip.b], r2);
+      curl(tmp, v);
+      e -= tmp;
+    }
+  }
+  return e;
+}
+
+fl model::eval_mutated(const precalculate& p, const igrid& ig, const vec& v,
+    const conf& c, const conf_mutation& mut, fl e) {
+  if (!ig.can_eval_atom() || ig.skip_interacting_pairs()) {
+    grid no_user_grid;
+    return eval(p, ig, v, c, no_user_grid);
+  }
+
+  vecv old_coords(coords);
+  std::vector<atom_range> moved;
+  set_mutated(c, mut, moved);
+
+  //a mutation moves its subtree rigidly, so only terms between a moved and
+  //an unmoved atom change
+  std::vector<bool> is_moved(atoms.size(), false);
+  VINA_FOR_IN(r, moved) {
+    VINA_RANGE(i, moved[r].begin, moved[r].end) {
+      is_moved[i] = true;
+      e += ig.eval_atom(*this, i, coords[i], v[1])
+          - ig.eval_atom(*this, i, old_coords[i], v[1]);
+    }
+  }
+  e += eval_moved_pairs(p, v[2], other_pairs, old_coords, is_moved);
+  VINA_FOR_IN(i, ligands)
+    e += eval_moved_pairs(p, v[0], ligands[i].pairs, old_coords, is_moved);
+  return e;
+}
+
 void model::initialize_gpu() {
   //TODO: only re-malloc if need larger size
   deallocate_gpu();
@@ -448,6 +448,12 @@ struct model {
     fl eval_adjusted(const scoring_function& sf, const precalculate& p,
         const igrid& ig, const vec& v, const conf& c, fl intramolecular_energy,
         const grid& user_grid);
+    //set c, which must differ from the conf coords were last set from only
+    //in the entity changed by mut, and return its energy as eval (without a
+    //user grid) would, given e, the energy of the current coords; only the
+    //moved subtree is recomputed and only terms involving it are rescored
+    fl eval_mutated(const precalculate& p, const igrid& ig, const vec& v,
+        const conf& c, const conf_mutation& mut, fl e);
 
     fl rmsd_lower_bound(const model& m) const; // uses coords
     fl rmsd_upper_bound(const model& m) const; // uses coords
@@ -515,6 +521,35 @@ struct model {
 
     fl get_minus_forces_sum_magnitude() const;
 
+    //complete state of an initialized model (gpu data excluded), used to
+    //cache prepared receptors; unlike atom serialization this includes bonds
+    //and the sdf atom indices that are normally only set during parsing
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive& ar, const unsigned version) {
+      ar & tree_width;
+      ar & coords;
+      ar & minus_forces;
+      ar & ligands;
+      ar & m_num_movable_atoms;
+      ar & atoms;
+      ar & grid_atoms;
+      ar & other_pairs;
+      ar & hydrogens_stripped;
+      ar & internal_coords;
+      ar & flex;
+      ar & flex_context;
+      ar & name;
+      ar & pose_num;
+      VINA_FOR_IN(i, atoms)
+        ar & atoms[i].bonds;
+      VINA_FOR_IN(i, grid_atoms)
+        ar & grid_atoms[i].bonds;
+      serialize_sdf_indices(ar, flex_context);
+      VINA_FOR_IN(i, ligands)
+        serialize_sdf_indices(ar, ligands[i].cont);
+    }
+
     //allocate gpu memory, model must be setup
     //also copies over data that does not change during minimization
     //if model changes, must re-initialize
@@ -577,6 +612,14 @@ struct model {
       ofile out(name);
       write_context(c, out, remark);
     }
+    template<class Archive>
+    static void serialize_sdf_indices(Archive& ar, context& c) {
+      VINA_FOR_IN(i, c.sdftext.atoms) {
+        ar & c.sdftext.atoms[i].index;
+        ar & c.sdftext.atoms[i].inflex;
+      }
+    }
+
     // actually static
     fl rmsd_lower_bound_asymmetric(const model& x, const model& y) const;
 
@@ -598,6 +641,13 @@ struct model {
         const interacting_pairs& pairs, const vecv& coords) const;
     fl eval_interacting_pairs_deriv(const precalculate& p, fl v,
         const interacting_pairs& pairs, const vecv& coords, vecv& forces) const;
+    //change in the energy of the pairs with exactly one moved atom
+    fl eval_moved_pairs(const precalculate& p, fl v,
+        const interacting_pairs& pairs, const vecv& old_coords,
+        const std::vector<bool>& moved) const;
+    //set c like set, but only recompute the coords moved by mut
+    void set_mutated(const conf& c, const conf_mutation& mut,
+        std::vector<atom_range>& moved);
 
     bool hydrogens_stripped;
     vecv internal_coords;
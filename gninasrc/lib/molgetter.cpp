@@ -17,7 +17,12 @@
 //mostly because Matt kept complaining about it, this will automatically create
 //pdbqts if necessary using open babel
 void MolGetter::create_init_model(const std::string& rigid_name,
-    const std::string& flex_name, FlexInfo& finfo, tee& log) {
+    const std::string& flex_name, FlexInfo& finfo, tee& log,
+    const receptor_cache *rcache) {
+  initms.push_back(model());
+  model& initm = initms.back();
+  if (rcache && rcache->load(initm, log)) return;
+
   if (rigid_name.size() > 0) {
     //support specifying flexible residues explicitly as pdbqt, but only
     //in compatibility mode where receptor is pdbqt as well
@@ -90,6 +95,7 @@ void MolGetter::create_init_model(const std::string& rigid_name,
   }
 
   if (strip_hydrogens) initm.strip_hydrogens();
+  if (rcache) rcache->save(initm, log);
 }
 
 //setup for reading from fname
@@ -102,11 +108,11 @@ void MolGetter::setInputFile(const std::string& fname) {
       type = PDBQT;
       pdbqtdone = false;
     } else
-      if (infile.open(lpath, ".smina", true)) //smina always gzipped
+      if (infile.open(lpath, ".smina", true, threads)) //smina always gzipped
           {
         type = SMINA;
       } else
-        if (infile.open(lpath, ".gnina", true)) //gnina always gzipped
+        if (infile.open(lpath, ".gnina", true, threads)) //gnina always gzipped
             {
           type = GNINA;
         } else
@@ -115,24 +121,49 @@ void MolGetter::setInputFile(const std::string& fname) {
             type = OB;
             //clear in case we had previous file
             infileopener.clear();
-            infileopener.openForInput(conv, fname);
+            infileopener.openForInput(conv, fname, threads);
             VINA_CHECK(conv.SetOutFormat("PDBQT"));
 
           }
   }
 }
 
-//initialize model to initm and add next molecule
+//initialize model to the first receptor and add next molecule
 //return false if no molecule available;
 bool MolGetter::readMoleculeIntoModel(model &m) {
-  //reinit the model
-  m = initm;
+  model lig;
+  boost::optional<std::string> name;
+  if (!readLigand(lig, name)) return false;
+  m = initms[0];
+  if (name) m.set_name(*name);
+  if (type != NONE) m.append(lig);
+  return true;
+}
+
+//set ms[i] to receptor i with the next molecule added
+//return false if no molecule available;
+bool MolGetter::readMoleculeIntoModels(std::vector<model>& ms) {
+  model lig;
+  boost::optional<std::string> name;
+  if (!readLigand(lig, name)) return false;
+  ms.resize(initms.size());
+  VINA_FOR_IN(i, ms) {
+    ms[i] = initms[i];
+    if (name) ms[i].set_name(*name);
+    if (type != NONE) ms[i].append(lig);
+  }
+  return true;
+}
+
+//read the next ligand into lig, name is set if the input provides one
+bool MolGetter::readLigand(model& lig, boost::optional<std::string>& name) {
   switch (type) {
   case SMINA:
   case GNINA: {
     parsing_struct p;
     context c;
     unsigned torsdof = 0;
+    if (!skipToWanted()) return false;
     if (!infile) return false;
     try {
       boost::archive::binary_iarchive serialin(infile,
@@ -140,6 +171,7 @@ bool MolGetter::readMoleculeIntoModel(model &m) {
       serialin >> torsdof;
       serialin >> p;
       serialin >> c;
+      current = nrecords++;
 
       non_rigid_parsed nr;
       postprocess_ligand(nr, p, c, torsdof);
@@ -151,11 +183,11 @@ bool MolGetter::readMoleculeIntoModel(model &m) {
 
       if (c.sdftext.valid()) {
         //set name
-        m.set_name(c.sdftext.name);
+        name = c.sdftext.name;
       }
 
       if (strip_hydrogens) tmp.m.strip_hydrogens();
-      m.append(tmp.m);
+      lig = tmp.m;
 
       return true;
     } catch (boost::archive::archive_exception& e) {
@@ -164,21 +196,22 @@ bool MolGetter::readMoleculeIntoModel(model &m) {
   }
     break;
   case PDBQT: {
+    if (!skipToWanted()) return false;
     if (pdbqtdone) return false; //can only read one
-    model lig = parse_ligand_pdbqt(lpath);
+    current = nrecords++;
+    lig = parse_ligand_pdbqt(lpath);
     if (strip_hydrogens) lig.strip_hydrogens();
-    m.append(lig);
     pdbqtdone = true;
     return true;
   }
     break;
   case OB: {
     OpenBabel::OBMol mol;
-    while (conv.Read(&mol)) //will return after first success
+    while (skipToWanted() && conv.Read(&mol)) //will return after first success
     {
-      std::string name = mol.GetTitle();
+      current = nrecords++;
+      name = std::string(mol.GetTitle());
       mol.StripSalts();
-      m.set_name(name);
       try {
         parsing_struct p;
         context c;
@@ -193,7 +226,7 @@ bool MolGetter::readMoleculeIntoModel(model &m) {
         tmp.initialize(nr.mobility_matrix());
         if (strip_hydrogens) tmp.m.strip_hydrogens();
 
-        m.append(tmp.m);
+        lig = tmp.m;
         return true;
       } catch (parse_error& e) {
         std::cerr << "\n\nParse error with molecule " << mol.GetTitle()
@@ -212,3 +245,55 @@ bool MolGetter::readMoleculeIntoModel(model &m) {
   return false; //shouldn't get here
 #endif
 }
+
+//advance past the next record without preparing it, false if none
+bool MolGetter::skipRecord() {
+  switch (type) {
+  case SMINA:
+  case GNINA: {
+    //no index, so the record has to be deserialized to find its end
+    parsing_struct p;
+    context c;
+    unsigned torsdof = 0;
+    if (!infile) return false;
+    try {
+      boost::archive::binary_iarchive serialin(infile,
+          boost::archive::no_header | boost::archive::no_tracking);
+      serialin >> torsdof;
+      serialin >> p;
+      serialin >> c;
+      return true;
+    } catch (boost::archive::archive_exception& e) {
+      return false;
+    }
+  }
+  case PDBQT:
+    if (pdbqtdone) return false;
+    pdbqtdone = true;
+    return true;
+  case OB: {
+    //formats like sdf can scan to the end of a record without perceiving it
+    OpenBabel::OBFormat *format = conv.GetInFormat();
+    int ret = format ? format->SkipObjects(1, &conv) : 0;
+    if (ret == 0) { //not implemented, have to read it
+      OpenBabel::OBMol mol;
+      return conv.Read(&mol);
+    }
+    return ret > 0;
+  }
+  case NONE:
+    return true;
+  }
+#ifndef __NVCC__
+  return false; //shouldn't get here
+#endif
+}
+
+//skip records until the next one is to be read, false if none
+bool MolGetter::skipToWanted() {
+  while (nrecords < first || nrecords % nshards != shard) {
+    if (!skipRecord()) return false;
+    nrecords++;
+  }
+  return true;
+}
@@ -11,6 +11,7 @@
 #include "model.h"
 #include "obmolopener.h"
 #include "flexinfo.h"
+#include "receptor_cache.h"
 
 //this class abstracts reading molecules from a file
 //we have three means of input:
@@ -18,7 +19,7 @@
 //vina parse_pdbqt for pdbqt files (one ligand, obey rotational bonds)
 //smina format
 class MolGetter {
-    model initm;
+    std::vector<model> initms; //one initial model per receptor of the ensemble
     enum Type {
       OB, PDBQT, SMINA, GNINA, NONE
     }; //different inputs
@@ -37,34 +38,89 @@ class MolGetter {
     //pdbqt data
     bool pdbqtdone;
 
+    //only records whose index is shard mod nshards and at least first are
+    //read, records are counted across all input files
+    sz shard, nshards;
+    sz first;
+    sz nrecords; //records consumed so far
+    sz current; //index of the record last read
+    unsigned threads; //for decompressing input, 0 for one per core
+
+    //advance past the next record without preparing it, false if none
+    bool skipRecord();
+    //skip records until the next one is to be read, false if none
+    bool skipToWanted();
+
+    //read and prepare the next ligand into lig, setting name if the input
+    //names it; return false if no molecule available
+    bool readLigand(model& lig, boost::optional<std::string>& name);
+
   public:
 
     MolGetter(bool addH = true, bool stripH = true)
         : add_hydrogens(addH), strip_hydrogens(stripH), type(NONE),
-            pdbqtdone(false) {
+            pdbqtdone(false), shard(0), nshards(1), first(0), nrecords(0),
+            current(0), threads(0) {
     }
 
     MolGetter(const std::string& rigid_name, const std::string& flex_name,
         FlexInfo& finfo, bool addH, bool stripH, tee& log)
         : add_hydrogens(addH), strip_hydrogens(stripH), type(NONE),
-            pdbqtdone(false) {
+            pdbqtdone(false), shard(0), nshards(1), first(0), nrecords(0),
+            current(0), threads(0) {
       create_init_model(rigid_name, flex_name, finfo, log);
     }
 
-    //create the initial model from the specified receptor files
+    //create the initial model from the specified receptor files and add it
+    //to the ensemble of receptors ligands are read into
+    //if rcache is provided the model is loaded from it when valid, otherwise
+    //it is written there once prepared
     void create_init_model(const std::string& rigid_name,
-        const std::string& flex_name, FlexInfo& finfo, tee& log);
+        const std::string& flex_name, FlexInfo& finfo, tee& log,
+        const receptor_cache *rcache = NULL);
 
     //setup for reading from fname
     void setInputFile(const std::string& fname);
 
-    //initialize model to initm and add next molecule
+    //read only every n-th record starting with record k (k < n); the
+    //others are scanned past without being parsed when the format allows
+    void setShard(sz k, sz n) {
+      shard = k;
+      nshards = n;
+    }
+
+    //skip the records before r, as when resuming a run
+    void setFirstRecord(sz r) {
+      first = r;
+    }
+
+    //number of threads decompressing input files opened after this
+    void setThreads(unsigned n) {
+      threads = n;
+    }
+
+    //index among all input records of the molecule last read
+    sz recordIndex() const {
+      return current;
+    }
+
+    //initialize model to the initial model of the first receptor and add
+    //next molecule
     //return false if no molecule available;
     bool readMoleculeIntoModel(model &m);
 
-    //return model without ligand
-    const model& getInitModel() const {
-      return initm;
+    //set ms[i] to the initial model of receptor i with the next molecule
+    //added, which is only parsed and prepared once for the whole ensemble
+    //return false if no molecule available;
+    bool readMoleculeIntoModels(std::vector<model>& ms);
+
+    //return model of receptor i without ligand
+    const model& getInitModel(sz i = 0) const {
+      return initms[i];
+    }
+
+    sz num_receptors() const {
+      return initms.size();
     }
 };
 
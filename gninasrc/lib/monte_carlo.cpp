@@ -24,6 +24,7 @@
 #include "coords.h"
 #include "mutate.h"
 #include "quasi_newton.h"
+#include "metrics.h"
 
 output_type monte_carlo::operator()(model& m, const precalculate& p, igrid& ig,
     const vec& corner1, const vec& corner2, incrementable* increment_me,
@@ -35,6 +36,29 @@ output_type monte_carlo::operator()(model& m, const precalculate& p, igrid& ig,
   return tmp.front();
 }
 
+void mc_pose_board::publish(sz chain, const output_type& pose) {
+  boost::mutex::scoped_lock lk(lock);
+  add_to_output_container(poses, pose, min_rmsd, max_size);
+  if (agree_chains == 0) return;
+
+  VINA_CHECK(chain < best.size());
+  best[chain] = pose.coords;
+  sz agree = 0;
+  VINA_FOR_IN(i, best) {
+    if (best[i].size() == pose.coords.size()
+        && rmsd_upper_bound(pose.coords, best[i]) < min_rmsd)
+      agree++;
+  }
+  if (agree >= agree_chains) done = true;
+}
+
+bool mc_pose_board::sample(output_type& out, rng& generator) {
+  boost::mutex::scoped_lock lk(lock);
+  if (poses.empty()) return false;
+  out = poses[random_sz(0, poses.size() - 1, generator)];
+  return true;
+}
+
 bool metropolis_accept(fl old_f, fl new_f, fl temperature, rng& generator) {
   if (new_f < old_f) return true;
   const fl acceptance_probability = std::exp((old_f - new_f) / temperature);
@@ -89,28 +113,66 @@ output_type monte_carlo::many_runs(model& m, const precalculate& p, igrid& ig,
 }
 
 // out is sorted
-void monte_carlo::operator()(model& m, output_container& out,
+unsigned monte_carlo::operator()(model& m, output_container& out,
     const precalculate& p, igrid& ig, const vec& corner1, const vec& corner2,
-    incrementable* increment_me, rng& generator, grid& user_grid) const {
+    incrementable* increment_me, rng& generator, grid& user_grid,
+    mc_pose_board* board, sz chain) const {
+  metric_timer timer(MetricMonteCarlo);
   vec authentic_v(1000, 1000, 1000); // FIXME? this is here to avoid max_fl/max_fl
   conf_size s = m.get_size();
   change g(s, ig.move_receptor());
   output_type tmp(conf(s, ig.move_receptor()), 0);
   tmp.c.randomize(corner1, corner2, generator);
   fl best_e = max_fl;
+  const fl improvement_tol = 0.01; //smaller changes in best_e don't count as progress
+  unsigned last_improvement = 0;
   minimization_params minparms = ssd_par.minparm;
 
   if (minparms.maxiters == 0) minparms.maxiters = ssd_par.evals;
   quasi_newton quasi_newton_par(minparms);
-  VINA_U_FOR(step, num_steps) {
+
+  //prescreening scores a mutation incrementally from the unminimized
+  //energy of tmp, which is valid while m is still set to tmp.c
+  const vec& search_v = minparms.single_min ? authentic_v : hunt_cap;
+  bool use_prescreen = prescreen > 0 && ig.can_eval_atom()
+      && !user_grid.initialized();
+  bool tmp_is_set = false;
+  fl tmp_unminimized_e = 0;
+
+  unsigned step = 0;
+  for (; step < num_steps; step++) {
+    if (stall_steps > 0 && step - last_improvement >= stall_steps) break;
+    //a chain that has not saved a pose yet keeps going after convergence
+    if (board && board->converged() && !out.empty()) break;
     if (increment_me) ++(*increment_me);
+    if (board && reseed_steps > 0 && step > 0 && step % reseed_steps == 0
+        && step - last_improvement >= reseed_steps) {
+      //stuck for a whole period, jump to a good pose found by any chain
+      if (board->sample(tmp, generator)) {
+        last_improvement = step;
+        tmp_is_set = false;
+      }
+    }
     output_type candidate = tmp;
-    mutate_conf(candidate.c, m, mutation_amplitude, generator);
+    conf_mutation mut;
+    mutate_conf(candidate.c, m, mutation_amplitude, generator, &mut);
 
-    if (minparms.single_min) //use full v to begin with
-      quasi_newton_par(m, p, ig, candidate, g, authentic_v, user_grid);
-    else
-      quasi_newton_par(m, p, ig, candidate, g, hunt_cap, user_grid);
+    if (use_prescreen && step > 0) {
+      if (!tmp_is_set) {
+        tmp_unminimized_e = m.eval(p, ig, search_v, tmp.c, user_grid);
+        tmp_is_set = true;
+      }
+      fl e = m.eval_mutated(p, ig, search_v, candidate.c, mut,
+          tmp_unminimized_e);
+      if (e - tmp_unminimized_e > prescreen) {
+        //undoing the mutation restores exactly the coords of tmp.c
+        m.eval_mutated(p, ig, search_v, tmp.c, mut, e);
+        continue;
+      }
+    }
+
+    quasi_newton_par(m, p, ig, candidate, g, search_v, user_grid);
+    tmp_is_set = false;
 
     if (step == 0
         || metropolis_accept(tmp.e, candidate.e, temperature, generator)) {
@@ -126,10 +188,19 @@ void monte_carlo::operator()(model& m, output_container& out,
         }
         tmp.coords = m.get_heavy_atom_movable_coords();
         add_to_output_container(out, tmp, min_rmsd, num_saved_mins); // 20 - max size
-        if (tmp.e < best_e) best_e = tmp.e;
+        if (tmp.e < best_e) {
+          if (tmp.e < best_e - improvement_tol) last_improvement = step;
+          best_e = tmp.e;
+          if (board) board->publish(chain, tmp);
+        }
       }
     }
   }
+  if (increment_me) { //account for skipped steps so progress completes
+    for (unsigned i = step; i < num_steps; i++)
+      ++(*increment_me);
+  }
   VINA_CHECK(!out.empty());
   VINA_CHECK(out.front().e <= out.back().e); // make sure the sorting worked in the correct order
+  return step;
 }
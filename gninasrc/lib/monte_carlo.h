@@ -23,9 +23,40 @@
 #ifndef VINA_MONTE_CARLO_H
 #define VINA_MONTE_CARLO_H
 
+#include <atomic>
+#include <boost/thread/mutex.hpp>
 #include "ssd.h"
 #include "incrementable.h"
 
+//shared by the chains of a parallel search: collects the best poses found
+//by any chain (without duplicates) so that stalled chains can restart from
+//them, and detects when enough chains have independently found the same
+//best pose
+struct mc_pose_board {
+    sz agree_chains; //number of chains that must agree, 0 disables
+    fl min_rmsd; //poses closer than this are the same
+    sz max_size; //number of poses kept on the board
+
+    mc_pose_board(sz num_chains, sz agree, fl rmsd, sz max_sz)
+        : agree_chains(agree), min_rmsd(rmsd), max_size(max_sz),
+            best(num_chains), done(false) {
+    }
+
+    //record the new best pose of chain and check for agreement
+    void publish(sz chain, const output_type& pose);
+    //copy a random pose from the board into out, false if the board is empty
+    bool sample(output_type& out, rng& generator);
+    bool converged() const {
+      return done;
+    }
+
+  private:
+    boost::mutex lock;
+    std::vector<vecv> best; //best pose of each chain, empty if none yet
+    output_container poses; //sorted best poses of all chains
+    std::atomic<bool> done;
+};
+
 struct monte_carlo {
     unsigned num_steps;
     fl temperature;
@@ -33,10 +64,14 @@ struct monte_carlo {
     fl min_rmsd;
     sz num_saved_mins;
     fl mutation_amplitude;
+    unsigned stall_steps; //stop after this many steps without improvement, 0 disables
+    unsigned reseed_steps; //restart from the shared board if stalled this long, 0 disables
+    fl prescreen; //skip minimizing mutations raising the energy more than this, 0 disables
     ssd ssd_par;
     monte_carlo()
         : num_steps(2500), temperature(1.2), hunt_cap(10, 1.5, 10),
-            min_rmsd(0.5), num_saved_mins(50), mutation_amplitude(2) {
+            min_rmsd(0.5), num_saved_mins(50), mutation_amplitude(2),
+            stall_steps(0), reseed_steps(0), prescreen(0) {
     } // T = 600K, R = 2cal/(K*mol) -> temperature = RT = 1.2;  num_steps = 50*lig_atoms = 2500
 
     output_type operator()(model& m, const precalculate& p, igrid& ig,
@@ -48,10 +83,12 @@ struct monte_carlo {
 
     void single_run(model& m, output_type& out, const precalculate& p,
         igrid& ig, rng& generator, grid& user_grid) const;
-    // out is sorted
-    void operator()(model& m, output_container& out, const precalculate& p,
+    // out is sorted; chain identifies this run on the board
+    // returns the number of steps taken, fewer than num_steps if it ended early
+    unsigned operator()(model& m, output_container& out, const precalculate& p,
         igrid& ig, const vec& corner1, const vec& corner2,
-        incrementable* increment_me, rng& generator, grid& user_grid) const;
+        incrementable* increment_me, rng& generator, grid& user_grid,
+        mc_pose_board* board = NULL, sz chain = 0) const;
     void many_runs(model& m, output_container& out, const precalculate& p,
         igrid& ig, const vec& corner1, const vec& corner2, sz num_runs,
         rng& generator, grid& user_grid) const;
@@ -32,7 +32,9 @@ sz count_mutable_entities(const conf& c) {
 }
 
 // does not set model
-void mutate_conf(conf& c, const model& m, fl amplitude, rng& generator) { // ONE OF: 2A for position, similar amp for orientation, randomize torsion
+void mutate_conf(conf& c, const model& m, fl amplitude, rng& generator,
+    conf_mutation* mut) { // ONE OF: 2A for position, similar amp for orientation, randomize torsion
+  if (mut) *mut = conf_mutation();
   sz mutable_entities_num = count_mutable_entities(c);
   if (mutable_entities_num == 0) return;
   int which_int = random_int(0, int(mutable_entities_num - 1), generator);
@@ -44,6 +46,7 @@ void mutate_conf(conf& c, const model& m, fl amplitude, rng& generator) { // ONE
     if (which == 0) {
       c.ligands[i].rigid.position += amplitude
           * random_inside_sphere(generator);
+      if (mut) *mut = conf_mutation(conf_mutation::Position, i);
       return;
     }
     --which;
@@ -53,12 +56,14 @@ void mutate_conf(conf& c, const model& m, fl amplitude, rng& generator) { // ONE
         vec rotation;
         rotation = amplitude / gr * random_inside_sphere(generator);
         quaternion_increment(c.ligands[i].rigid.orientation, rotation);
+        if (mut) *mut = conf_mutation(conf_mutation::Orientation, i);
       }
       return;
     }
     --which;
     if (which < c.ligands[i].torsions.size()) {
       c.ligands[i].torsions[which] = random_fl(-pi, pi, generator);
+      if (mut) *mut = conf_mutation(conf_mutation::LigandTorsion, i, which);
       return;
     }
     which -= c.ligands[i].torsions.size();
@@ -66,6 +71,7 @@ void mutate_conf(conf& c, const model& m, fl amplitude, rng& generator) { // ONE
   VINA_FOR_IN(i, c.flex) {
     if (which < c.flex[i].torsions.size()) {
       c.flex[i].torsions[which] = random_fl(-pi, pi, generator);
+      if (mut) *mut = conf_mutation(conf_mutation::FlexTorsion, i, which);
       return;
     }
     which -= c.flex[i].torsions.size();
@@ -25,7 +25,8 @@
 
 #include "model.h"
 
-// does not set model
-void mutate_conf(conf& c, const model& m, fl amplitude, rng& generator);
+// does not set model; if mut is given it is set to what was changed
+void mutate_conf(conf& c, const model& m, fl amplitude, rng& generator,
+    conf_mutation* mut = NULL);
 
 #endif
@@ -21,16 +21,123 @@
  */
 
 #include "naive_non_cache.h"
+#include "brick.h"
 #include "curl.h"
+#include <algorithm>
+#include <boost/functional/hash.hpp>
 
-naive_non_cache::naive_non_cache(const precalculate* p_)
-    : p(p_) {
+//slack added to the cutoff when deciding which cells to visit so rounding
+//can never drop an atom a full scan would include
+static const fl cell_slack = 0.01;
+
+std::size_t receptor_cells::receptor_hash(const atomv& grid_atoms) {
+  std::size_t h = 0;
+  VINA_FOR_IN(i, grid_atoms) {
+    boost::hash_combine(h, grid_atoms[i].get());
+    VINA_FOR(d, 3)
+      boost::hash_combine(h, grid_atoms[i].coords[d]);
+  }
+  return h;
+}
+
+receptor_cells::receptor_cells(const model& m, fl cutoff_sqr_)
+    : cutoff_sqr(cutoff_sqr_), side(std::sqrt(cutoff_sqr_) / 2),
+        num_grid_atoms(m.get_fixed_atoms().size()),
+        hash(receptor_hash(m.get_fixed_atoms())) {
+  const atomv& grid_atoms = m.get_fixed_atoms();
+  sz n = num_atom_types();
+  szv used;
+  vec lo(max_fl, max_fl, max_fl), hi(-max_fl, -max_fl, -max_fl);
+  VINA_FOR_IN(i, grid_atoms) {
+    smt t = grid_atoms[i].get();
+    if (t >= n || is_hydrogen(t)) continue;
+    used.push_back(i);
+    VINA_FOR(d, 3) {
+      lo[d] = std::min(lo[d], grid_atoms[i].coords[d]);
+      hi[d] = std::max(hi[d], grid_atoms[i].coords[d]);
+    }
+  }
+  origin = lo;
+  sz ncells = 1;
+  VINA_FOR(d, 3) {
+    dims[d] = used.empty() ? 0 : int((hi[d] - lo[d]) / side) + 1;
+    ncells *= dims[d];
+  }
+
+  //counting sort by cell, which keeps indices increasing within a cell
+  szv cell_of(used.size());
+  cell_start.assign(ncells + 1, 0);
+  VINA_FOR_IN(k, used) {
+    const vec& c = grid_atoms[used[k]].coords;
+    sz cell = 0;
+    VINA_FOR(d, 3) {
+      int x = std::min(int((c[d] - origin[d]) / side), dims[d] - 1);
+      cell = cell * dims[d] + x;
+    }
+    cell_of[k] = cell;
+    cell_start[cell + 1]++;
+  }
+  VINA_FOR(c, ncells)
+    cell_start[c + 1] += cell_start[c];
+  atoms.resize(used.size());
+  szv next(cell_start.begin(), cell_start.end() - 1);
+  VINA_FOR_IN(k, used)
+    atoms[next[cell_of[k]]++] = used[k];
+}
+
+void receptor_cells::neighbors(const vec& coord, szv& out) const {
+  out.clear();
+  if (atoms.empty()) return;
+  const fl cut = std::sqrt(cutoff_sqr) + cell_slack;
+  int lo[3], hi[3];
+  VINA_FOR(d, 3) {
+    fl begin = (coord[d] - cut - origin[d]) / side;
+    fl end = (coord[d] + cut - origin[d]) / side;
+    if (!(end >= 0 && begin < dims[d])) return; //nothing in range (or nan)
+    lo[d] = begin < 0 ? 0 : int(begin);
+    hi[d] = end >= dims[d] ? dims[d] - 1 : int(end);
+  }
+
+  for (int x = lo[0]; x <= hi[0]; x++) {
+    for (int y = lo[1]; y <= hi[1]; y++) {
+      for (int z = lo[2]; z <= hi[2]; z++) {
+        vec begin(origin[0] + x * side, origin[1] + y * side,
+            origin[2] + z * side);
+        vec end(begin[0] + side, begin[1] + side, begin[2] + side);
+        if (brick_distance_sqr(begin, end, coord) > cut * cut) continue;
+        sz c = (sz(x) * dims[1] + y) * dims[2] + z;
+        out.insert(out.end(), atoms.begin() + cell_start[c],
+            atoms.begin() + cell_start[c + 1]);
+      }
+    }
+  }
+  std::sort(out.begin(), out.end());
+}
+
+naive_non_cache::naive_non_cache(const precalculate* p_,
+    const receptor_cells* cells_)
+    : p(p_), cells(cells_) {
 }
+
+//add the energy between a and b to e if they are scorable and within cutoff
+static inline void add_pair_energy(const precalculate* p, const atom& a,
+    const vec& a_coords, const atom& b, fl cutoff_sqr, sz n, fl& e) {
+  smt t2 = b.get();
+  if (t2 >= n || is_hydrogen(t2)) return;
+  vec r_ba;
+  r_ba = a_coords - b.coords;
+  fl r2 = sqr(r_ba);
+  if (r2 < cutoff_sqr) {
+    e += p->eval(a, b, r2);
+  }
+}
+
 fl naive_non_cache::eval(const model& m, fl v) const { // needs m.coords
   fl e = 0;
   const fl cutoff_sqr = p->cutoff_sqr();
 
   sz n = num_atom_types();
+  szv nearby;
 
   VINA_FOR(i, m.num_movable_atoms()) {
     fl this_e = 0;
@@ -39,20 +146,18 @@ fl naive_non_cache::eval(const model& m, fl v) const { // needs m.coords
     if (t1 >= n || is_hydrogen(t1)) continue;
     const vec& a_coords = m.coords[i];
 
-    VINA_FOR_IN(j, m.grid_atoms) {
-      const atom& b = m.grid_atoms[j];
-      smt t2 = b.get();
-      if (t2 >= n || is_hydrogen(t2)) continue;
-      vec r_ba;
-      r_ba = a_coords - b.coords;
-      fl r2 = sqr(r_ba);
-      if (r2 < cutoff_sqr) {
-        this_e += p->eval(a, b, r2);
-      }
+    if (cells) {
+      cells->neighbors(a_coords, nearby);
+      VINA_FOR_IN(k, nearby)
+        add_pair_energy(p, a, a_coords, m.grid_atoms[nearby[k]], cutoff_sqr,
+            n, this_e);
+    } else {
+      VINA_FOR_IN(j, m.grid_atoms)
+        add_pair_energy(p, a, a_coords, m.grid_atoms[j], cutoff_sqr, n,
+            this_e);
     }
     curl(this_e, v);
     e += this_e;
   }
   return e;
 }
-
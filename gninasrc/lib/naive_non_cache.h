@@ -26,8 +26,42 @@
 #include "igrid.h"
 #include "model.h"
 
+//the scorable receptor (grid) atoms binned into cubes half the
+//cutoff on a side, so exact scoring only looks at atoms near each ligand
+//atom; built once per receptor and only read afterwards, so it can be shared
+//by every thread
+struct receptor_cells {
+    receptor_cells(const model& m, fl cutoff_sqr_);
+
+    //set out to the indices of the grid atoms that may be within the cutoff
+    //of coord, in increasing order so sums over them match a full scan
+    void neighbors(const vec& coord, szv& out) const;
+
+    //true if built from m's receptor for a cutoff of at least cut_sqr; this
+    //visits every receptor atom, so check once per model, not per evaluation
+    bool usable(const model& m, fl cut_sqr) const {
+      const atomv& grid_atoms = m.get_fixed_atoms();
+      return grid_atoms.size() == num_grid_atoms && cut_sqr <= cutoff_sqr
+          && receptor_hash(grid_atoms) == hash;
+    }
+  private:
+    fl cutoff_sqr;
+    fl side;
+    vec origin;
+    int dims[3];
+    sz num_grid_atoms;
+    std::size_t hash; //of the types and coordinates of the grid atoms
+    szv cell_start; //atoms of cell c are atoms[cell_start[c]..cell_start[c+1])
+    szv atoms; //grid atom indices, ordered by cell and then index
+
+    static std::size_t receptor_hash(const atomv& grid_atoms);
+};
+
 struct naive_non_cache : public igrid {
-    naive_non_cache(const precalculate* p_);
+    //if cells are provided they must outlive this, be usable for the models
+    //evaluated with p's cutoff and are used to only visit nearby receptor
+    //atoms; energies are identical either way
+    naive_non_cache(const precalculate* p_, const receptor_cells* cells_ = NULL);
     virtual fl eval(const model& m, fl v) const; // needs m.coords
     virtual fl eval_deriv(model& m, fl v, const grid& user_grid) const {
       VINA_CHECK(false);
@@ -37,6 +71,7 @@ struct naive_non_cache : public igrid {
     void eval_atoms(const model& m, std::vector<flv>& per_atom_values) const;
   private:
     const precalculate* p;
+    const receptor_cells* cells;
 };
 
 #endif
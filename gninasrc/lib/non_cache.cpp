@@ -51,35 +51,37 @@ fl non_cache::check_bounds(const grid_dims& dims, const vec& a_coords,
 
 fl non_cache::eval(const model& m, fl v) const { // clean up
   fl e = 0;
-  const fl cutoff_sqr = p->cutoff_sqr();
-  sz n = num_atom_types();
-  VINA_FOR(i, m.num_movable_atoms()) {
-    const atom& a = m.atoms[i];
-    smt t1 = a.get();
-    if (t1 >= n || is_hydrogen(t1)) continue;
+  VINA_FOR(i, m.num_movable_atoms())
+    e += non_cache::eval_atom(m, i, m.coords[i], v);
+  return e;
+}
 
-    const vec& a_coords = m.coords[i];
-    vec adjusted_a_coords;
-    fl out_of_bounds_penalty = check_bounds(gd, a_coords, adjusted_a_coords);
-    fl this_e = 0;
-    const szv& possibilities = sgrid.possibilities(adjusted_a_coords);
-    VINA_FOR_IN(possibilities_j, possibilities) {
-      const sz j = possibilities[possibilities_j];
-      const atom& b = m.grid_atoms[j];
-      smt t2 = b.get();
-      vec r_ba;
-      r_ba = adjusted_a_coords - b.coords; // FIXME why b-a and not a-b ?
-      fl r2 = sqr(r_ba);
-      if (r2 < cutoff_sqr) {
-        //jac241 - Use adjusted_a_coords or just a_coords?
-        //also how to verify they're ligand coordinates (table lookup?)
-        this_e += p->eval(a, b, r2); // + user_grid.evaluate_user(adjusted_a_coords, slope, NULL);
-      }
+fl non_cache::eval_atom(const model& m, sz i, const vec& a_coords,
+    fl v) const {
+  const fl cutoff_sqr = p->cutoff_sqr();
+  const atom& a = m.atoms[i];
+  smt t1 = a.get();
+  if (t1 >= num_atom_types() || is_hydrogen(t1)) return 0;
+
+  vec adjusted_a_coords;
+  fl out_of_bounds_penalty = check_bounds(gd, a_coords, adjusted_a_coords);
+  fl this_e = 0;
+  const szv& possibilities = sgrid.possibilities(adjusted_a_coords);
+  VINA_FOR_IN(possibilities_j, possibilities) {
+    const sz j = possibilities[possibilities_j];
+    const atom& b = m.grid_atoms[j];
+    smt t2 = b.get();
+    vec r_ba;
+    r_ba = adjusted_a_coords - b.coords; // FIXME why b-a and not a-b ?
+    fl r2 = sqr(r_ba);
+    if (r2 < cutoff_sqr) {
+      //jac241 - Use adjusted_a_coords or just a_coords?
+      //also how to verify they're ligand coordinates (table lookup?)
+      this_e += p->eval(a, b, r2); // + user_grid.evaluate_user(adjusted_a_coords, slope, NULL);
     }
-    curl(this_e, v);
-    e += this_e + out_of_bounds_penalty;
   }
-  return e;
+  curl(this_e, v);
+  return this_e + out_of_bounds_penalty;
 }
 
 bool non_cache::within(const model& m, fl margin) const {
@@ -33,6 +33,10 @@ struct non_cache : public igrid {
     }
     virtual fl eval(const model& m, fl v) const; // needs m.coords // clean up
     virtual fl eval_deriv(model& m, fl v, const grid& user_grid) const; // needs m.coords, sets m.minus_forces // clean up
+    virtual bool can_eval_atom() const {
+      return true;
+    }
+    virtual fl eval_atom(const model& m, sz i, const vec& coords, fl v) const;
 
     fl check_bounds(const grid_dims& dims, const vec& a_coords,
         vec& adjusted_a_coords) const;
@@ -33,6 +33,9 @@ struct non_cache_gpu : public non_cache {
         const precalculate_gpu* p_, fl slope_);
     virtual void setSlope(fl sl);
     virtual ~non_cache_gpu();
+    virtual bool can_eval_atom() const {
+      return false;
+    } //receptor is on the device
     fl eval(const model& m, fl v) const;
     //evaluate the model on the gpu, v is the curl amount
     //sets m.minus_forces and returns total energy
@@ -29,7 +29,8 @@ obmol_opener::~obmol_opener() {
   clear();
 }
 
-void obmol_opener::openForInput(OBConversion& conv, const std::string& name) {
+void obmol_opener::openForInput(OBConversion& conv, const std::string& name,
+    unsigned threads) {
   OBFormat *format = conv.FormatFromExt(name);
 
   if (!format || !conv.SetInFormat(format)) {
@@ -39,16 +40,21 @@ void obmol_opener::openForInput(OBConversion& conv, const std::string& name) {
   //dkoes - annoyingly, although openbabel is smart enough to ignore
   //the .gz at the end of a file when determining the file format, it
   //does not actually open the file as a gzip stream
-  std::ifstream *uncompressed_inmol = new std::ifstream(name.c_str());
+  std::ifstream *uncompressed_inmol = new std::ifstream(name.c_str(),
+      std::ios::in | std::ios::binary);
   streams.push_back(uncompressed_inmol);
   filtering_stream<input> *inmol = new filtering_stream<input>();
   streams.push_back((std::istream*) inmol);
 
   std::string::size_type pos = name.rfind(".gz");
-  if (pos != std::string::npos) {
-    inmol->push(gzip_decompressor());
+  if (pos != std::string::npos && is_bgzf(*uncompressed_inmol)) {
+    inmol->push(bgzf_decompressor(*uncompressed_inmol, threads));
+  } else {
+    if (pos != std::string::npos) {
+      inmol->push(gzip_decompressor());
+    }
+    inmol->push(*uncompressed_inmol);
   }
-  inmol->push(*uncompressed_inmol);
 
   if (!*uncompressed_inmol || !*inmol) {
     throw file_error(path(name), true);
@@ -58,22 +64,24 @@ void obmol_opener::openForInput(OBConversion& conv, const std::string& name) {
 }
 
 void obmol_opener::obmol_opener::openForOutput(OBConversion& outconv,
-    const std::string& outname) {
+    const std::string& outname, unsigned threads) {
   OBFormat *outformat = outconv.FormatFromExt(outname);
   if (!outformat || !outconv.SetOutFormat(outformat)) {
     throw file_error(outname, false);
   }
 
-  std::ofstream *uncompressed_outfile = new std::ofstream(outname.c_str());
+  std::ofstream *uncompressed_outfile = new std::ofstream(outname.c_str(),
+      std::ios::out | std::ios::binary);
   filtering_stream<output>* outfile = new filtering_stream<output>();
   streams.push_back((std::ostream*) outfile);
   streams.push_back(uncompressed_outfile); //has to be deleted after filter
 
   std::string::size_type pos = outname.rfind(".gz");
   if (pos != std::string::npos) {
-    outfile->push(gzip_compressor());
+    outfile->push(bgzf_compressor(*uncompressed_outfile, threads));
+  } else {
+    outfile->push(*uncompressed_outfile);
   }
-  outfile->push(*uncompressed_outfile);
   if (!*outfile || !*uncompressed_outfile) {
     throw file_error(path(outname), false);
   }
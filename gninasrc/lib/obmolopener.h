@@ -23,8 +23,11 @@ class obmol_opener {
     }
     virtual ~obmol_opener();
 
-    void openForInput(OpenBabel::OBConversion& conv, const std::string& name);
-    void openForOutput(OpenBabel::OBConversion& conv, const std::string& name);
+    //gzipped files are (de)compressed by threads threads, 0 for one per core
+    void openForInput(OpenBabel::OBConversion& conv, const std::string& name,
+        unsigned threads = 0);
+    void openForOutput(OpenBabel::OBConversion& conv, const std::string& name,
+        unsigned threads = 0);
 
     void clear();
 
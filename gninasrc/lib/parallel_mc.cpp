@@ -20,6 +20,7 @@
 
  */
 
+#include <memory>
 #include "parallel.h"
 #include "parallel_mc.h"
 #include "coords.h"
@@ -33,8 +34,9 @@ struct parallel_mc_task {
     model m;
     output_container out;
     rng generator;
-    parallel_mc_task(const model& m_, int seed)
-        : m(m_), generator(static_cast<rng::result_type>(seed)) {
+    sz chain;
+    parallel_mc_task(const model& m_, int seed, sz chain_)
+        : m(m_), generator(static_cast<rng::result_type>(seed)), chain(chain_) {
       if (m_.gpu_initialized() && m.gdata.device_on) {
         //TODO: need to ensure that worker threads using these copies can't
         //deallocate GPU memory - race condition in
@@ -68,11 +70,14 @@ struct parallel_mc_aux {
     const vec* corner2;
     parallel_progress* pg;
     grid* user_grid;
+    mc_pose_board* board;
+    std::atomic<unsigned long>* steps;
     parallel_mc_aux(const monte_carlo* mc_, const precalculate* p_, igrid* ig_,
         const vec* corner1_, const vec* corner2_, parallel_progress* pg_,
-        grid* user_grid_)
+        grid* user_grid_, mc_pose_board* board_,
+        std::atomic<unsigned long>* steps_)
         : mc(mc_), p(p_), ig(ig_), corner1(corner1_), corner2(corner2_),
-            pg(pg_), user_grid(user_grid_) {
+            pg(pg_), user_grid(user_grid_), board(board_), steps(steps_) {
     }
 
     void operator()(parallel_mc_task& t) const {
@@ -147,11 +152,11 @@ struct parallel_mc_aux {
         szv_grid_cache gridcache(t.m, p->cutoff_sqr());
         non_cache_cnn new_cnn(gridcache, cnn->get_grid_dims(), p,
             cnn->getSlope(), cnn_scorer);
-        (*mc)(t.m, t.out, *p, new_cnn, *corner1, *corner2, pg, t.generator,
-            *user_grid);
+        *steps += (*mc)(t.m, t.out, *p, new_cnn, *corner1, *corner2, pg,
+            t.generator, *user_grid, board, t.chain);
       } else
-        (*mc)(t.m, t.out, *p, *ig, *corner1, *corner2, pg, t.generator,
-            *user_grid);
+        *steps += (*mc)(t.m, t.out, *p, *ig, *corner1, *corner2, pg,
+            t.generator, *user_grid, board, t.chain);
     }
 };
 
@@ -172,16 +177,22 @@ void merge_output_containers(const parallel_mc_task_container& many,
   out.sort();
 }
 
-void parallel_mc::operator()(const model& m, output_container& out,
+unsigned long parallel_mc::operator()(const model& m, output_container& out,
     const precalculate& p, igrid& ig, const vec& corner1, const vec& corner2,
     rng& generator, grid& user_grid) const {
   parallel_progress pp;
+  //chains only share poses when they can use them
+  std::unique_ptr<mc_pose_board> board;
+  if (agree_chains > 0 || mc.reseed_steps > 0)
+    board.reset(new mc_pose_board(num_tasks, agree_chains, mc.min_rmsd,
+        mc.num_saved_mins));
+  std::atomic<unsigned long> steps(0);
   parallel_mc_aux parallel_mc_aux_instance(&mc, &p, &ig, &corner1, &corner2,
-      (display_progress ? (&pp) : NULL), &user_grid);
+      (display_progress ? (&pp) : NULL), &user_grid, board.get(), &steps);
   parallel_mc_task_container task_container;
   VINA_FOR(i, num_tasks)
     task_container.push_back(
-        new parallel_mc_task(m, random_int(0, 1000000, generator)));
+        new parallel_mc_task(m, random_int(0, 1000000, generator), i));
   if (display_progress) pp.init(num_tasks * mc.num_steps);
 
   auto thread_init = [&]()
@@ -194,6 +205,11 @@ void parallel_mc::operator()(const model& m, output_container& out,
       if (!cnn)
         thread_buffer.init(available_mem(num_threads));
     }
+    else
+    {
+      //every core already runs a chain, so CNN layers should not spawn more
+      caffe::Caffe::set_cpu_threads(1);
+    }
   };
 
   parallel_iter<parallel_mc_aux,
@@ -203,5 +219,5 @@ void parallel_mc::operator()(const model& m, output_container& out,
   parallel_iter_instance.run(task_container);
 
   merge_output_containers(task_container, out, mc.min_rmsd, mc.num_saved_mins);
-
+  return steps;
 }
@@ -29,11 +29,13 @@ struct parallel_mc {
     monte_carlo mc;
     sz num_tasks;
     sz num_threads;
+    sz agree_chains; //stop once this many chains share a best pose, 0 disables
     bool display_progress;
     parallel_mc()
-        : num_tasks(8), num_threads(1), display_progress(true) {
+        : num_tasks(8), num_threads(1), agree_chains(0), display_progress(true) {
     }
-    void operator()(const model& m, output_container& out,
+    //returns the total number of monte carlo steps taken
+    unsigned long operator()(const model& m, output_container& out,
         const precalculate& p, igrid& ig, const vec& corner1,
         const vec& corner2, rng& generator, grid& user_grid) const;
 };
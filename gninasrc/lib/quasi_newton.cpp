@@ -25,6 +25,7 @@
 #include "quasi_newton.h"
 #include "bfgs.h"
 #include "device_buffer.h"
+#include "metrics.h"
 
 struct quasi_newton_aux {
     model* m;
@@ -42,6 +43,11 @@ struct quasi_newton_aux {
     }
 
     fl operator()(const conf& c, change& g) {
+      //called for every line search step, so don't even set up a timer
+      //unless metrics are being collected
+      if (!metrics::enabled())
+        return m->eval_deriv(*p, *ig, v, c, g, *user_grid);
+      metric_timer timer(MetricBFGSEval);
       return m->eval_deriv(*p, *ig, v, c, g, *user_grid);
     }
 };
@@ -49,6 +55,7 @@ struct quasi_newton_aux {
 void quasi_newton::operator()(model& m, const precalculate& p, igrid& ig,
     output_type& out, change& g, const vec& v, const grid& user_grid) const {
   // g must have correct size
+  metric_timer timer(MetricBFGS);
   const non_cache_gpu* n_gpu = dynamic_cast<const non_cache_gpu*>(&ig);
   const cache_gpu* c_gpu = dynamic_cast<const cache_gpu*>(&ig);
   if (n_gpu || c_gpu) {
@@ -0,0 +1,136 @@
+/*
+ * receptor_cache.cpp
+ */
+
+#include "receptor_cache.h"
+#include <cstring>
+#include <boost/crc.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/archive_exception.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/filesystem.hpp>
+
+namespace {
+
+const char cache_magic[8] = { 'G', 'N', 'I', 'N', 'A', 'R', 'E', 'C' };
+
+struct cache_header {
+    char magic[8];
+    boost::uint32_t version;
+    boost::uint32_t crc;
+    boost::uint64_t size; //bytes of payload following the header
+    //archives are not portable, so record what they were written with
+    boost::uint32_t fl_size;
+    boost::uint32_t sz_size;
+};
+
+boost::uint32_t checksum(const char *data, sz n) {
+  boost::crc_32_type crc;
+  crc.process_bytes(data, n);
+  return crc.checksum();
+}
+
+}
+
+void receptor_cache::add_dependency(const std::string& file) {
+  using namespace boost::filesystem;
+  if (file.size() == 0) return;
+  path p(file);
+  boost::system::error_code ec;
+  path full = canonical(p, ec);
+  key << "file=" << (ec ? p.string() : full.string());
+  if (exists(p, ec)) key << ' ' << file_size(p) << ' ' << last_write_time(p);
+  key << '\n';
+}
+
+bool receptor_cache::load(model& m, tee& log) const {
+  namespace io = boost::iostreams;
+  if (!boost::filesystem::exists(fname)) return false;
+
+  try {
+    io::mapped_file_source mapped(fname);
+    const char *data = mapped.data();
+    cache_header h;
+    if (mapped.size() < sizeof(h)) return false;
+    std::memcpy(&h, data, sizeof(h));
+    if (std::memcmp(h.magic, cache_magic, sizeof(cache_magic)) != 0
+        || h.version != version || h.fl_size != sizeof(fl)
+        || h.sz_size != sizeof(sz)
+        || h.size != mapped.size() - sizeof(h)) {
+      log << "Ignoring incompatible receptor cache " << fname << "\n";
+      return false;
+    }
+    const char *payload = data + sizeof(h);
+    if (checksum(payload, h.size) != h.crc) {
+      log << "Ignoring corrupt receptor cache " << fname << "\n";
+      return false;
+    }
+
+    io::stream<io::array_source> in(payload, h.size);
+    boost::archive::binary_iarchive serialin(in,
+        boost::archive::no_header | boost::archive::no_tracking);
+    std::string k;
+    serialin >> k;
+    if (k != key.str()) {
+      log << "Receptor cache " << fname
+          << " was built from different inputs, rebuilding\n";
+      return false;
+    }
+    model tmp;
+    serialin >> tmp;
+    m = tmp;
+  } catch (std::exception& e) {
+    log << "Could not read receptor cache " << fname << ": " << e.what()
+        << "\n";
+    return false;
+  }
+  return true;
+}
+
+void receptor_cache::save(const model& m, tee& log) const {
+  std::stringstream payload;
+  {
+    boost::archive::binary_oarchive serialout(payload,
+        boost::archive::no_header | boost::archive::no_tracking);
+    std::string k = key.str();
+    serialout << k;
+    serialout << m;
+  }
+  std::string buf = payload.str();
+
+  cache_header h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, cache_magic, sizeof(cache_magic));
+  h.version = version;
+  h.size = buf.size();
+  h.crc = checksum(buf.data(), buf.size());
+  h.fl_size = sizeof(fl);
+  h.sz_size = sizeof(sz);
+
+  //write to a temporary in the same directory and rename over the cache
+  path target(fname);
+  path tmpname = target.parent_path()
+      / boost::filesystem::unique_path(target.filename().string() + ".%%%%%%");
+  try {
+    {
+      ofile out(tmpname, std::ios::binary);
+      out.write((const char*) &h, sizeof(h));
+      out.write(buf.data(), buf.size());
+      if (!out) throw file_error(tmpname, false);
+    }
+    boost::filesystem::rename(tmpname, target);
+  } catch (file_error& e) {
+    boost::system::error_code ec;
+    boost::filesystem::remove(tmpname, ec);
+    log << "WARNING: could not write receptor cache " << fname << "\n";
+  } catch (boost::filesystem::filesystem_error& e) {
+    boost::system::error_code ec;
+    boost::filesystem::remove(tmpname, ec);
+    log << "WARNING: could not write receptor cache " << fname << ": "
+        << e.what() << "\n";
+  }
+}
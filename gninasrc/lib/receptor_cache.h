@@ -0,0 +1,59 @@
+/*
+ * receptor_cache.h
+ */
+
+#ifndef SMINA_RECEPTOR_CACHE_H
+#define SMINA_RECEPTOR_CACHE_H
+
+#include <string>
+#include <sstream>
+#include "model.h"
+#include "tee.h"
+
+/* Binary snapshot of a fully prepared receptor model.  Preparing a receptor
+ * with OpenBabel (adding hydrogens, charges, pdbqt round trip, typing) is repeated by every invocation, which dominates
+ * the runtime of short jobs.  The cache file stores the initialized model
+ * along with a key describing everything it was built from (receptor files
+ * and the options that affect preparation) so a stale cache is never used.
+ * Flexible residues selected with --flexres/--flexdist are not part of the
+ * snapshot, so the cache is not used with those options.
+ *
+ * File layout: fixed header (magic, format version, payload size, crc32 of
+ * payload) followed by a boost binary archive of the key and the model.
+ * The file is memory mapped and verified before it is deserialized.
+ */
+class receptor_cache {
+    std::string fname;
+    std::stringstream key; //identifies the inputs the model was built from
+
+  public:
+    //bump whenever the serialized layout of model changes
+    static const unsigned version = 1;
+
+    receptor_cache(const std::string& f)
+        : fname(f) {
+    }
+
+    const std::string& name() const {
+      return fname;
+    }
+
+    //the cache is only valid for this file as it currently exists on disk
+    void add_dependency(const std::string& file);
+
+    //the cache is only valid for this setting of an option
+    template<typename T>
+    void add_setting(const std::string& name, const T& val) {
+      key << name << '=' << val << '\n';
+    }
+
+    //set m from the cache file, return false if the file does not exist, is
+    //corrupt or was built from different inputs
+    bool load(model& m, tee& log) const;
+
+    //write m to the cache file; the file is replaced atomically so that
+    //concurrent jobs never see a partially written cache
+    void save(const model& m, tee& log) const;
+};
+
+#endif /* SMINA_RECEPTOR_CACHE_H */
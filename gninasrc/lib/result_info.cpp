@@ -11,6 +11,11 @@
 #include <openbabel/generic.h>
 #include <cstring>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+
+//results are written from several threads, but openbabel conversion shares
+//global state (format registry, element tables, obErrorLog)
+static boost::mutex obconv_lock;
 
 void result_info::setMolecule(const model& m) {
   std::stringstream str;
@@ -64,6 +69,28 @@ void result_info::setAtomValues(const model& m, const weighted_terms *wt) {
   atominfo = str.str();
 }
 
+fl result_info::score(pose_sort_order order) const {
+  switch (order) {
+  case Energy:
+    return -energy;
+  case CNNaffinity:
+    return cnnaffinity;
+  case CNNscore:
+  default:
+    return cnnscore;
+  }
+}
+
+void result_info::writeScores(std::ostream& out) const {
+  //format locally so the caller's stream flags are untouched
+  std::stringstream str;
+  str << std::fixed << std::setprecision(5) << energy << ",";
+  if (cnnscore >= 0) str << std::setprecision(10) << cnnscore;
+  str << ",";
+  if (cnnaffinity != 0) str << std::setprecision(10) << cnnaffinity;
+  out << str.str();
+}
+
 //helper function for setting molecular data that will wrap data in remark
 //if output format is pdb; copy by value because we might change things
 static void setMolData(OpenBabel::OBFormat *format, OpenBabel::OBMol& mol,
@@ -86,6 +113,7 @@ static void setMolData(OpenBabel::OBFormat *format, OpenBabel::OBMol& mol,
 //output flexible residue conformers
 void result_info::writeFlex(std::ostream& out, std::string& ext, int modelnum) {
   using namespace OpenBabel;
+  boost::mutex::scoped_lock lock(obconv_lock);
   OBMol mol;
   OBConversion outconv;
   OBFormat *format = outconv.FormatFromExt(ext);
@@ -108,10 +136,11 @@ void result_info::writeFlex(std::ostream& out, std::string& ext, int modelnum) {
 void result_info::write(std::ostream& out, std::string& ext,
     bool include_atom_terms, const weighted_terms *wt, int modelnum) {
   using namespace OpenBabel;
-  OBMol mol;
-  OBConversion outconv;
-
-  OBFormat *format = outconv.FormatFromExt(ext);
+  OBFormat *format = NULL;
+  {
+    boost::mutex::scoped_lock lock(obconv_lock);
+    format = OBConversion::FormatFromExt(ext);
+  }
 
   if(!format) {
     throw usage_error("Invalid format: "+ext);
@@ -144,6 +173,11 @@ void result_info::write(std::ostream& out, std::string& ext,
       out << std::fixed << std::setprecision(10) << cnnvariance << "\n\n";
     }
 
+    for (unsigned i = 0, n = properties.size(); i < n; i++) {
+      out << "> <" << properties[i].first << ">\n";
+      out << properties[i].second << "\n\n";
+    }
+
     if (include_atom_terms) {
       std::stringstream astr;
       writeAtomValues(astr, wt);
@@ -166,10 +200,16 @@ void result_info::write(std::ostream& out, std::string& ext,
       if (cnnaffinity != 0)
         out << "REMARK CNNaffinity "
             << boost::lexical_cast<std::string>((float) cnnaffinity);
+      for (unsigned i = 0, n = properties.size(); i < n; i++)
+        out << "REMARK " << properties[i].first << " "
+            << properties[i].second;
       out << molstr;
       out << "ENDMDL\n";
     } else //convert with openbabel
     {
+      boost::mutex::scoped_lock lock(obconv_lock);
+      OBMol mol;
+      OBConversion outconv;
       if (sdfvalid)
         outconv.SetInFormat("SDF");
       else
@@ -194,6 +234,9 @@ void result_info::write(std::ostream& out, std::string& ext,
         setMolData(format, mol, "CNNaffinity",
             boost::lexical_cast<std::string>((float) cnnaffinity));
       }
+      for (unsigned i = 0, n = properties.size(); i < n; i++) {
+        setMolData(format, mol, properties[i].first, properties[i].second);
+      }
 
       if (include_atom_terms) {
         std::stringstream astr;
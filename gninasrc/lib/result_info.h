@@ -13,6 +13,7 @@
 #include "model.h"
 #include "weighted_terms.h"
 #include "cnn_scorer.h"
+#include "user_opts.h"
 
 // this class holds the contents of the result of a minization/docking
 // it handles outputing the molecular data in the appropriate format
@@ -26,6 +27,8 @@ class result_info {
     std::string flexstr;
     std::string atominfo;
     std::string name;
+    //extra named values to output with the pose
+    std::vector<std::pair<std::string, std::string> > properties;
     bool sdfvalid;
 
   public:
@@ -50,6 +53,18 @@ class result_info {
         const weighted_terms *wt = NULL, int modelnum = 0);
 
     void writeFlex(std::ostream& out, std::string& ext, int modelnum = 0);
+
+    //output value as the data field (or remark) name of the pose
+    void addProperty(const std::string& name, const std::string& value) {
+      properties.push_back(std::make_pair(name, value));
+    }
+
+    //score to rank the pose by, oriented so that larger is better
+    fl score(pose_sort_order order) const;
+
+    //write minimizedAffinity,CNNscore,CNNaffinity as csv fields, leaving
+    //out the CNN values if there are none
+    void writeScores(std::ostream& out) const;
 };
 
 #endif /* RESULT_INFO_H_ */
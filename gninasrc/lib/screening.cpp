@@ -0,0 +1,49 @@
+/*
+ * screening.cpp
+ */
+
+#include "screening.h"
+#include <cmath>
+
+bool screening_filter::accept(fl score) {
+  boost::mutex::scoped_lock lk(lock);
+  seen++;
+
+  //insert into the appropriate heap
+  if (!top.empty() && score >= top.top())
+    top.push(score);
+  else
+    rest.push(score);
+
+  //rebalance so top holds exactly the best ceil(fraction*seen) scores
+  sz want = sz(std::ceil(fraction * seen));
+  if (want < 1) want = 1;
+  while (top.size() < want && !rest.empty()) {
+    top.push(rest.top());
+    rest.pop();
+  }
+  while (top.size() > want) {
+    rest.push(top.top());
+    top.pop();
+  }
+
+  if (seen <= warmup)
+    return true;
+  //a ligand with nothing in the box never earns the full search, even if
+  //the top fraction so far is all such ligands
+  return score > -max_fl && score >= top.top();
+}
+
+fl screening_filter::score(const output_type& out, pose_sort_order order) {
+  if (!not_max(out.e))
+    return -max_fl; //nothing in the box
+  switch (order) {
+  case Energy:
+    return -out.e;
+  case CNNaffinity:
+    return out.cnnaffinity;
+  case CNNscore:
+  default:
+    return out.cnnscore;
+  }
+}
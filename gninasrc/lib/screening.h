@@ -0,0 +1,51 @@
+/*
+ * screening.h
+ */
+
+#ifndef SMINA_SCREENING_H
+#define SMINA_SCREENING_H
+
+#include <queue>
+#include <vector>
+#include <functional>
+#include <boost/thread/mutex.hpp>
+
+#include "common.h"
+#include "conf.h"
+#include "user_opts.h"
+
+/* Early rejection of unpromising ligands for large virtual screens.
+ * Every ligand is first docked with a fraction of the normal search effort.
+ * The best score of this first stage is compared against the first stage
+ * scores of all the ligands seen so far and only ligands that fall within the
+ * top fraction are docked with the full exhaustiveness.  The threshold is a
+ * running quantile, so ligands can be streamed to the output as they finish.
+ */
+class screening_filter {
+    fl fraction; //fraction of ligands that get the full search
+    sz warmup; //accept everything until this many ligands have been seen
+    sz seen;
+
+    //best ceil(fraction*seen) scores in a min heap, everything else in a max heap
+    std::priority_queue<fl, std::vector<fl>, std::greater<fl> > top;
+    std::priority_queue<fl> rest;
+    boost::mutex lock;
+
+  public:
+    screening_filter(fl frac = 1.0, sz warm = 0)
+        : fraction(frac), warmup(warm), seen(0) {
+    }
+
+    bool enabled() const {
+      return fraction < 1.0;
+    }
+
+    //record score (larger is better) and return true if the ligand should
+    //be docked with the full search effort
+    bool accept(fl score);
+
+    //score to rank a docked pose by, oriented so that larger is better
+    static fl score(const output_type& out, pose_sort_order order);
+};
+
+#endif /* SMINA_SCREENING_H */
@@ -24,33 +24,74 @@
 #define VINA_TEE_H
 
 #include <iostream>
+#include <sstream>
 #include "file.h"
 
 struct tee {
     bool quiet;
     ofile* of;
+    std::ostringstream* buf; //if set, output is collected here instead
     tee(bool q = false)
-        : of(NULL), quiet(q) {
+        : of(NULL), quiet(q), buf(NULL) {
     }
     void init(const path& name) {
       of = new ofile(name);
     }
     virtual ~tee() {
       delete of;
+      delete buf;
+    }
+    //collect output in memory, formatted as out is, so that it can be taken
+    //and passed to out.write in one piece; nothing is flushed
+    void buffer(const tee& out) {
+      delete buf;
+      buf = new std::ostringstream;
+      if (!out.quiet)
+        buf->copyfmt(std::cout);
+      else if (out.of)
+        buf->copyfmt(*out.of);
+    }
+    //return and clear the collected output
+    std::string take() {
+      std::string ret = buf->str();
+      buf->str("");
+      return ret;
+    }
+    //write s as is without flushing
+    void write(const std::string& s) {
+      if (buf) {
+        buf->write(s.data(), s.size());
+        return;
+      }
+      if (!quiet) std::cout.write(s.data(), s.size());
+      if (of) of->write(s.data(), s.size());
     }
     void flush() {
+      if (buf) return;
       if (!quiet) std::cout << std::flush;
       if (of) (*of) << std::flush;
     }
     void endl() {
+      if (buf) {
+        (*buf) << '\n';
+        return;
+      }
       if (!quiet) std::cout << std::endl;
       if (of) (*of) << std::endl;
     }
     void setf(std::ios::fmtflags a) {
+      if (buf) {
+        buf->setf(a);
+        return;
+      }
       if (!quiet) std::cout.setf(a);
       if (of) of->setf(a);
     }
     void setf(std::ios::fmtflags a, std::ios::fmtflags b) {
+      if (buf) {
+        buf->setf(a, b);
+        return;
+      }
       if (!quiet) std::cout.setf(a, b);
       if (of) of->setf(a, b);
     }
@@ -58,6 +99,10 @@ struct tee {
 
 template<typename T>
 tee& operator<<(tee& out, const T& x) {
+  if (out.buf) {
+    (*out.buf) << x;
+    return out;
+  }
   if (!out.quiet) std::cout << x;
   if (out.of) (*out.of) << x;
   return out;
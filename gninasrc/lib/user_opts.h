@@ -37,6 +37,7 @@ struct cnn_options {
     std::string cnn_recmap; //optional file specifying receptor atom typing to channel map
     std::string cnn_ligmap; //optional file specifying ligand atom typing to channel map
     std::vector<std::string> cnn_model_names; // name of builtin model
+    std::string cnn_bundle_file; //precompiled built-in models, created if missing
     vec cnn_center;
     fl resolution; //this isn't specified in model file, so be careful about straying from default
     unsigned cnn_rotations; //do we want to score multiple orientations?
@@ -51,6 +52,10 @@ struct cnn_options {
     bool mix_emp_force;//merge empirical and CNN minus forces
     bool mix_emp_energy;//merge empirical and CNN energy
     bool verbose;
+    bool quantize_int8; //approximate cpu inference with int8 products
+    bool share_memory; //let blobs share memory, nets are only run with Forward and Backward
+    bool inference_only; //gradients are never needed, so activations can share memory too
+    bool simplify_net; //fold batch norms and skip empty channels, only off to check the result
 
     std::string xyzprefix;
     unsigned seed; //random seed
@@ -60,7 +65,7 @@ struct cnn_options {
            resolution(0.5), cnn_rotations(0), cnn_scoring(CNNrescore),
             subgrid_dim(0.0), outputdx(false),
             outputxyz(false), gradient_check(false), move_minimize_frame(false),
-            fix_receptor(false), verbose(false), mix_emp_force(false),mix_emp_energy(false),empirical_weight(1.0),seed(0) {
+            fix_receptor(false), verbose(false), quantize_int8(false), share_memory(false), inference_only(false), simplify_net(true), mix_emp_force(false),mix_emp_energy(false),empirical_weight(1.0),seed(0) {
     }
 
     bool moving_receptor() const {
@@ -84,14 +89,24 @@ struct user_settings {
     int exhaustiveness;
     int num_mc_steps;
     int num_mc_saved;
+    int mc_stall_steps; //end chains early if they stop improving
+    int mc_agree_chains; //end search early once chains agree on the best pose
+    int mc_reseed_steps; //restart stalled chains from the best poses of all chains
+    fl mc_prescreen; //skip minimizing mutations that raise the energy more than this
+    fl mc_granularity; //grid spacing during the monte carlo search, 0 uses the box spacing
     pose_sort_order sort_order;
 
+    fl screen_fraction; //fraction of ligands given the full search, 1 disables screening
+    fl screen_effort; //fraction of the search effort of the first screening stage
+    sz screen_warmup; //number of ligands always given the full search
+
     bool score_only;
     bool randomize_only;
     bool local_only;
     bool dominimize;
     bool include_atom_info;
     bool gpu_docking; //use gpu for non-CNN operations too
+    bool grid_bf16; //store the search grid as bfloat16
     bool no_gpu;
 
 
@@ -101,9 +116,14 @@ struct user_settings {
     user_settings()
         :  num_modes(9), out_min_rmsd(1), forcecap(1000),
             seed(auto_seed()), verbosity(1), cpu(1), device(0),
-            exhaustiveness(10), num_mc_steps(0), num_mc_saved(50), sort_order(CNNscore), score_only(false),
+            exhaustiveness(10), num_mc_steps(0), num_mc_saved(50),
+            mc_stall_steps(0), mc_agree_chains(0), mc_reseed_steps(0),
+            mc_prescreen(0), mc_granularity(0),
+            sort_order(CNNscore),
+            screen_fraction(1.0), screen_effort(0.1), screen_warmup(100), score_only(false),
             randomize_only(false), local_only(false), dominimize(false),
-            include_atom_info(false), gpu_docking(false), no_gpu(false) {
+            include_atom_info(false), gpu_docking(false), grid_bf16(false),
+            no_gpu(false) {
 
     }
 };
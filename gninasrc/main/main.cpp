@@ -7,6 +7,7 @@
 #include <cmath> // for ceila
 #include <algorithm>
 #include <iterator>
+#include <queue>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/filesystem/exception.hpp>
 #include <boost/filesystem/convenience.hpp> // filesystem::basename
@@ -46,10 +47,14 @@
 #include "array3d.h"
 #include "grid.h"
 #include "molgetter.h"
+#include "receptor_cache.h"
+#include "checkpoint.h"
 #include "result_info.h"
 #include "box.h"
 #include "flexinfo.h"
 #include "builtinscoring.h"
+#include "screening.h"
+#include "metrics.h"
 #include <boost/thread/thread.hpp>
 #include <boost/ref.hpp>
 #include <boost/bind.hpp>
@@ -141,6 +146,7 @@ void refine_structure(model& m, const precalculate& prec, non_cache& nc,
     output_type& out, const vec& cap, const minimization_params& minparm,
     grid& user_grid, int verbosity, tee& log)
     {
+  metric_timer timer(MetricRefine);
   // std::cout << m.get_name() << " | pose " << m.get_pose_num() << " | refining structure\n";
   change g(m.get_size(), nc.move_receptor());
 
@@ -247,11 +253,15 @@ void do_search(model& m, const boost::optional<model>& ref,
     const parallel_mc& par, const user_settings& settings,
     bool compute_atominfo, tee& log,
     const terms *t, grid& user_grid, CNNScorer& cnn,
-    std::vector<result_info>& results)
+    const receptor_cells *cells,
+    std::vector<result_info>& results, screening_filter *screen = NULL)
 {
   boost::timer::cpu_timer time;
 
   precalculate_exact exact_prec(sf); //use exact computations for final score
+  //naive_non_cache trusts the cells, so make sure once that they are m's
+  if (cells && !cells->usable(m, exact_prec.cutoff_sqr()))
+    cells = NULL;
   conf_size s = m.get_size();
   conf c = m.get_initial_conf(nc.move_receptor());
   fl e = max_fl;
@@ -269,7 +279,7 @@ void do_search(model& m, const boost::optional<model>& ref,
     cnn.freeze_receptor();
     intramolecular_energy = m.eval_intramolecular(exact_prec,
         authentic_v, c);
-    naive_non_cache nnc(&exact_prec); // for out of grid issues
+    naive_non_cache nnc(&exact_prec, cells); // for out of grid issues
     e = m.eval_adjusted(sf, exact_prec, nnc, authentic_v, c,
         intramolecular_energy, user_grid);
     get_cnn_info(m, cnn, log, cnnscore, cnnaffinity, cnnvariance);
@@ -324,7 +334,7 @@ void do_search(model& m, const boost::optional<model>& ref,
     m.set(out.c);
 
     //be as exact as possible for final score
-    naive_non_cache nnc(&exact_prec); // for out of grid issues
+    naive_non_cache nnc(&exact_prec, cells); // for out of grid issues
 
     fl intramolecular_energy = m.eval_intramolecular(exact_prec,
         authentic_v,
@@ -367,44 +377,86 @@ void do_search(model& m, const boost::optional<model>& ref,
     log << "Using random seed: " << settings.seed;
     log.endl();
 
-    output_container out_cont;
-    doing(settings.verbosity, "Performing search", log);
-    par(m, out_cont, prec, ig, corner1, corner2, generator, user_grid);
-    done(settings.verbosity, log);
-    doing(settings.verbosity, "Refining results", log);
+    //refine, rescore, sort and remove redundant poses
+    auto refine_and_rank = [&](output_container& out_cont) {
+      doing(settings.verbosity, "Refining results", log);
 
-    VINA_FOR_IN(i, out_cont) {
-      refine_structure(m, prec, nc, out_cont[i], authentic_v,
-          par.mc.ssd_par.minparm, user_grid,settings.verbosity,log);
+      VINA_FOR_IN(i, out_cont) {
+        refine_structure(m, prec, nc, out_cont[i], authentic_v,
+            par.mc.ssd_par.minparm, user_grid,settings.verbosity,log);
 
-      get_cnn_info(m, cnn, log, cnnscore, cnnaffinity, cnnvariance);
+        get_cnn_info(m, cnn, log, cnnscore, cnnaffinity, cnnvariance);
 
-      out_cont[i].cnnscore = cnnscore;
-      out_cont[i].cnnaffinity = cnnaffinity;
-      out_cont[i].cnnvariance = cnnvariance;
+        out_cont[i].cnnscore = cnnscore;
+        out_cont[i].cnnaffinity = cnnaffinity;
+        out_cont[i].cnnvariance = cnnvariance;
 
-      if (not_max(out_cont[i].e)) {
-          intramolecular_energy = m.eval_intramolecular(exact_prec, authentic_v, out_cont[i].c);
-          out_cont[i].e = m.eval_adjusted(sf, exact_prec, nc, authentic_v, out_cont[i].c, intramolecular_energy, user_grid);
+        if (not_max(out_cont[i].e)) {
+            intramolecular_energy = m.eval_intramolecular(exact_prec, authentic_v, out_cont[i].c);
+            out_cont[i].e = m.eval_adjusted(sf, exact_prec, nc, authentic_v, out_cont[i].c, intramolecular_energy, user_grid);
+        }
       }
-    }
 
-    auto sorter = [settings](const output_type& lhs, const output_type& rhs) {
-      switch(settings.sort_order) {
-      case Energy:
-        return lhs.e < rhs.e;
-      case CNNaffinity:
-        return lhs.cnnaffinity > rhs.cnnaffinity; //reverse
-      case CNNscore:
-      default:
-        return lhs.cnnscore > rhs.cnnscore; //reverse
-      }
+      auto sorter = [settings](const output_type& lhs, const output_type& rhs) {
+        switch(settings.sort_order) {
+        case Energy:
+          return lhs.e < rhs.e;
+        case CNNaffinity:
+          return lhs.cnnaffinity > rhs.cnnaffinity; //reverse
+        case CNNscore:
+        default:
+          return lhs.cnnscore > rhs.cnnscore; //reverse
+        }
+      };
+
+      out_cont.sort(sorter);
+      out_cont = remove_redundant(out_cont, settings.out_min_rmsd);
+
+      done(settings.verbosity, log);
     };
 
-    out_cont.sort(sorter);
-    out_cont = remove_redundant(out_cont, settings.out_min_rmsd);
+    output_container out_cont;
+    bool full_search = true;
+    if (screen && screen->enabled()) {
+      //short first stage, only ligands that rank within the top fraction of
+      //those seen so far get the full search
+      parallel_mc quick(par);
+      quick.mc.num_steps = std::max(1u,
+          unsigned(par.mc.num_steps * settings.screen_effort));
+      doing(settings.verbosity, "Performing screening search", log);
+      quick(m, out_cont, prec, ig, corner1, corner2, generator, user_grid);
+      done(settings.verbosity, log);
+
+      //only need enough poses to rank the ligand
+      if (out_cont.size() > settings.num_modes)
+        out_cont.erase(out_cont.begin() + settings.num_modes, out_cont.end());
+      refine_and_rank(out_cont);
+
+      fl best = -max_fl;
+      if (!out_cont.empty())
+        best = screening_filter::score(out_cont.front(), settings.sort_order);
+      full_search = screen->accept(best);
+      if (full_search) {
+        out_cont.clear();
+      } else {
+        log << "Skipping full search, ligand did not pass screening filter";
+        log.endl();
+      }
+    }
 
-    done(settings.verbosity, log);
+    if (full_search) {
+      doing(settings.verbosity, "Performing search", log);
+      unsigned long steps = par(m, out_cont, prec, ig, corner1, corner2,
+          generator, user_grid);
+      done(settings.verbosity, log);
+      if (settings.verbosity > 1 || settings.mc_stall_steps > 0
+          || settings.mc_agree_chains > 0) {
+        log << "Monte Carlo steps used: " << steps << " of "
+            << (unsigned long) par.num_tasks * par.mc.num_steps;
+        log.endl();
+      }
+      refine_and_rank(out_cont);
+    }
 
     log.setf(std::ios::fixed, std::ios::floatfield);
     log.setf(std::ios::showpoint);
@@ -473,13 +525,29 @@ void load_ent_values(const grid_dims& gd, std::istream& user_in,
   std::cout << user_data(gd[0].n - 3, gd[1].n, gd[2].n) << "\n";
 }
 
+//grid dims covering the box of gd, about the same center, with points
+//granularity apart
+static grid_dims regrid_dims(const grid_dims& gd, fl granularity) {
+  grid_dims ret;
+  VINA_FOR_IN(i, gd)
+  {
+    fl center = (gd[i].begin + gd[i].end) / 2;
+    ret[i].n = std::max(sz(1), sz(std::ceil(gd[i].span() / granularity)));
+    fl real_span = granularity * ret[i].n;
+    ret[i].begin = center - real_span / 2;
+    ret[i].end = ret[i].begin + real_span;
+  }
+  return ret;
+}
+
 void main_procedure(model &m, precalculate &prec,
     const boost::optional<model> &ref, // m is non-const (FIXME?)
     const user_settings &settings,
     bool no_cache, bool compute_atominfo,
     const grid_dims &gd, minimization_params minparm,
     const weighted_terms &wt, tee &log,
-    std::vector<result_info> &results, grid &user_grid, CNNScorer &cnn)
+    std::vector<result_info> &results, grid &user_grid, CNNScorer &cnn,
+    const receptor_cells *cells, screening_filter *screen = NULL)
 {
   doing(settings.verbosity, "Setting up the scoring function", log);
 
@@ -504,8 +572,12 @@ void main_procedure(model &m, precalculate &prec,
   par.mc.min_rmsd = 1.0;
   par.mc.num_saved_mins = settings.num_modes > settings.num_mc_saved ? settings.num_modes : settings.num_mc_saved;
   par.mc.hunt_cap = vec(10, 10, 10);
+  par.mc.stall_steps = settings.mc_stall_steps;
+  par.mc.reseed_steps = settings.mc_reseed_steps;
+  par.mc.prescreen = settings.mc_prescreen;
   par.num_tasks = settings.exhaustiveness;
   par.num_threads = settings.cpu;
+  par.agree_chains = settings.mc_agree_chains;
   par.display_progress = true;
 
   szv_grid_cache gridcache(m, prec.cutoff_sqr());
@@ -537,8 +609,8 @@ void main_procedure(model &m, precalculate &prec,
     if (no_cache || settings.cnnopts.cnn_scoring == CNNall)  {
       do_search(m, ref, wt, prec, *nc, *nc, corner1, corner2, par,
           settings, compute_atominfo, log,
-          wt.unweighted_terms(), user_grid, cnn,
-          results);
+          wt.unweighted_terms(), user_grid, cnn, cells,
+          results, screen);
     }
     else
     {
@@ -547,11 +619,18 @@ void main_procedure(model &m, precalculate &prec,
 
       if (cache_needed)
         doing(settings.verbosity, "Analyzing the binding site", log);
+      //the cache is only used by the monte carlo search, final poses are
+      //refined with nc, so the search can use a coarser grid that is
+      //cheaper to build and fits better in cache
+      grid_dims search_gd = gd;
+      if (settings.mc_granularity > 0)
+        search_gd = regrid_dims(gd, settings.mc_granularity);
       std::unique_ptr<cache> c(
           (settings.gpu_docking) ?
               new cache_gpu("scoring_function_version001",
-                  gd, slope, dynamic_cast<precalculate_gpu*>(&prec)) :
-              new cache("scoring_function_version001", gd, slope));
+                  search_gd, slope, dynamic_cast<precalculate_gpu*>(&prec)) :
+              new cache("scoring_function_version001", search_gd, slope,
+                  settings.grid_bf16));
       if (cache_needed)
       {
         std::vector<smt> atom_types_needed;
@@ -561,7 +640,7 @@ void main_procedure(model &m, precalculate &prec,
       }
       do_search(m, ref, wt, prec, *c, *nc, corner1, corner2, par,
           settings, compute_atominfo, log,
-          wt.unweighted_terms(), user_grid, cnn, results);
+          wt.unweighted_terms(), user_grid, cnn, cells, results, screen);
     }
 
     delete nc;
@@ -708,20 +787,6 @@ void print_atom_info(std::ostream& out)
   }
 }
 
-const fl box_granularity = 0.375;
-
-//set grid dims to match center/size
-static void setup_grid_dims(fl center_x, fl center_y, fl center_z, fl size_x, fl size_y, fl size_z, grid_dims& gd) {
-  vec span(size_x, size_y, size_z);
-  vec center(center_x, center_y, center_z);
-  VINA_FOR_IN(i, gd)
-  {
-    gd[i].n = sz(std::ceil(span[i] / box_granularity));
-    fl real_span = box_granularity * gd[i].n;
-    gd[i].begin = center[i] - real_span / 2;
-    gd[i].end = gd[i].begin + real_span;
-  }
-}
 void setup_user_gd(grid_dims& gd, std::ifstream& user_in)
 {
   std::string line;
@@ -803,21 +868,23 @@ int initializeCUDA(int device)  {
 struct worker_job
 {
     unsigned int molid;
-    model* m;
+    unsigned int record; //index among all input records
+    std::vector<model>* ms; //the ligand with each receptor of the ensemble
     std::vector<result_info>* results;
     grid_dims gd;
 
-    worker_job(unsigned int molid, model* m, std::vector<result_info>* results,
+    worker_job(unsigned int molid, unsigned int record,
+        std::vector<model>* ms, std::vector<result_info>* results,
         grid_dims gd)
         :
-            molid(molid), m(m), results(results), gd(gd)
+            molid(molid), record(record), ms(ms), results(results), gd(gd)
     {
     }
     ;
 
     worker_job()
         :
-            molid(0), m(NULL), results(NULL)
+            molid(0), record(0), ms(NULL), results(NULL)
     {
       for (int i = 0; i < 3; i++)
           {
@@ -828,22 +895,59 @@ struct worker_job
 
 };
 
+//output of one ligand, already formatted by the worker that docked it so
+//that the writer thread only has to copy bytes in order
+struct rendered_output
+{
+    std::string out;
+    std::string flex;
+    std::string atoms;
+    std::string scores; //csv row
+    std::string log; //of the ligand when logs are buffered
+    fl score; //of the best pose by the sort order, larger is better
+};
+
+//a ligand held back for --top_k
+struct ranked_output
+{
+    fl score;
+    unsigned int molid;
+    rendered_output* rendered;
+
+    ranked_output(fl score, unsigned int molid, rendered_output* rendered)
+        :
+            score(score), molid(molid), rendered(rendered)
+    {
+    }
+    ;
+
+    //ranks ahead of rhs, so a priority_queue keeps the worst on top; ties go
+    //to the earlier ligand
+    bool operator<(const ranked_output& rhs) const {
+      if (score != rhs.score)
+        return score > rhs.score;
+      return molid < rhs.molid;
+    }
+};
+
 //writer queue job format
 struct writer_job
 {
     unsigned int molid;
-    std::vector<result_info>* results;
+    unsigned int record; //index among all input records
+    rendered_output* rendered;
 
-    writer_job(unsigned int molid, std::vector<result_info>* results)
+    writer_job(unsigned int molid, unsigned int record,
+        rendered_output* rendered)
         :
-            molid(molid), results(results)
+            molid(molid), record(record), rendered(rendered)
     {
     }
     ;
 
     writer_job()
         :
-            molid(0), results(NULL)
+            molid(0), record(0), rendered(NULL)
     {
     }
     ;
@@ -897,18 +1001,84 @@ struct global_state
     tee* log;
     std::ofstream* atomoutfile;
     cnn_options cnnopts;
+    screening_filter* screen;
+    //receptor atoms binned for exact final scoring, one per receptor of the
+    //ensemble, empty if not needed
+    std::vector<boost::shared_ptr<receptor_cells> > cells;
+    //receptor names to record in the output when there is an ensemble
+    std::vector<std::string> receptors;
+    //record the input record of each ligand in the output
+    bool tag_records;
+    //where to periodically record progress, empty for none
+    std::string checkpoint_name;
+    fl checkpoint_interval; //seconds
+    checkpoint progress; //as of the start of the run
+    //only write the best top_k ligands at the end, 0 to write all
+    sz top_k;
+    //csv of the best scores of every ligand, NULL if not writing it
+    std::ofstream* scorefile;
+    //formats of the output files, empty if not writing that file
+    std::string outext;
+    std::string outfext;
 
     global_state(user_settings* settings, boost::shared_ptr<precalculate> prec,
         minimization_params* minparms, weighted_terms* wt,
-        grid* user_grid, tee* log, std::ofstream* atomoutfile, const cnn_options& co):
+        grid* user_grid, tee* log, std::ofstream* atomoutfile, const cnn_options& co,
+        screening_filter* screen, const std::string& outext,
+        const std::string& outfext):
         settings(settings), prec(prec), minparms(minparms), wt(wt),
             user_grid(user_grid), log(log), atomoutfile(atomoutfile),
-            cnnopts(co)
+            cnnopts(co), screen(screen), outext(outext), outfext(outfext),
+            tag_records(false), checkpoint_interval(0), top_k(0),
+            scorefile(NULL)
     {
     }
     ;
 };
 
+//format the results of a ligand into the output file formats
+void render_out(std::vector<result_info> &results, const global_state &gs,
+    rendered_output &r)
+    {
+  metric_timer timer(MetricOutput);
+  if (gs.outext.size() > 0)
+  {
+    //write out molecular data
+    std::string ext = gs.outext;
+    std::stringstream out;
+    for (unsigned j = 0, nr = results.size(); j < nr; j++) {
+      results[j].write(out, ext, gs.settings->include_atom_info, gs.wt,
+          j + 1);
+    }
+    r.out = out.str();
+  }
+  if (gs.outfext.size() > 0)
+  {
+    //write out flexible residue data data
+    std::string fext = gs.outfext;
+    std::stringstream flex;
+    for (unsigned j = 0, nr = results.size(); j < nr; j++) {
+      results[j].writeFlex(flex, fext, j + 1);
+    }
+    r.flex = flex.str();
+  }
+  if (gs.atomoutfile->is_open())
+  {
+    std::stringstream atoms;
+    for (unsigned j = 0, m = results.size(); j < m; j++) {
+      results[j].writeAtomValues(atoms, gs.wt);
+    }
+    r.atoms = atoms.str();
+  }
+}
+
+//quote s for a csv file if needed
+static std::string csv_field(const std::string& s) {
+  if (s.find_first_of(",\"\n") == std::string::npos)
+    return s;
+  return "\"" + boost::replace_all_copy(s, "\"", "\"\"") + "\"";
+}
+
 //function to occupy the worker threads with individual ligands from the work queue
 //TODO: see if implementing weight sharing between CNNScorer instances results
 //in enough memory efficiency to avoid using a single one
@@ -918,87 +1088,197 @@ void threads_at_work(job_queue<worker_job> *wrkq,
 {
   if(!gs->settings->no_gpu)
     initializeCUDA(gs->settings->device);
-  
+
+  //CPU layers of the CNN may use the cores other workers are not using; with
+  //local_only every core has its own worker, otherwise this is the only one
+  //and docking has finished with the cores by the time poses are scored
+  caffe::Caffe::set_cpu_threads(gs->settings->local_only ? 1 : gs->settings->cpu);
+
   if (gs->settings->gpu_docking)
     thread_buffer.init(available_mem(gs->settings->cpu));
 
+  //the scorer keeps the receptor atoms it first sees, so each receptor of
+  //the ensemble needs its own
+  std::vector<CNNScorer> cnns(mols->num_receptors(), cnn_scorer);
+
+  //with a worker per core, each ligand logs to its own buffer that the
+  //writer emits in order, so lines of different ligands do not interleave
+  //and no line is flushed on its own; a single worker logs directly so
+  //that the log keeps pace with the search progress bar
+  tee joblog;
+  bool buffered = gs->settings->local_only;
+  if (buffered)
+    joblog.buffer(*gs->log);
+  tee& log = buffered ? joblog : *gs->log;
+
   worker_job j;
   while (!wrkq->wait_and_pop(j))
   {
     __sync_fetch_and_add(nligs, 1);
 
-    main_procedure(*(j.m), *gs->prec, boost::optional<model>(),
-        *gs->settings,
-        false, // no_cache == false
-        gs->atomoutfile->is_open()
-            || gs->settings->include_atom_info, j.gd,
-        *gs->minparms, *gs->wt, *gs->log, *(j.results),
-        *gs->user_grid, cnn_scorer);
+    std::vector<model>& ms = *j.ms;
+    VINA_FOR_IN(r, ms) {
+      std::vector<result_info> results;
+      if (ms.size() > 1) {
+        log << "Receptor: " << gs->receptors[r];
+        log.endl();
+      }
+      main_procedure(ms[r], *gs->prec, boost::optional<model>(),
+          *gs->settings,
+          false, // no_cache == false
+          gs->atomoutfile->is_open()
+              || gs->settings->include_atom_info, j.gd,
+          *gs->minparms, *gs->wt, log, results,
+          *gs->user_grid, cnns[r],
+          r < gs->cells.size() ? gs->cells[r].get() : NULL, gs->screen);
+      if (ms.size() > 1) {
+        VINA_FOR_IN(i, results)
+          results[i].addProperty("receptor", gs->receptors[r]);
+      }
+      j.results->insert(j.results->end(), results.begin(), results.end());
+    }
+    if (ms.size() > 1) {
+      //best poses over the ensemble
+      pose_sort_order order = gs->settings->sort_order;
+      std::stable_sort(j.results->begin(), j.results->end(),
+          [order](const result_info& lhs, const result_info& rhs) {
+            return lhs.score(order) > rhs.score(order);
+          });
+      if (j.results->size() > gs->settings->num_modes)
+        j.results->resize(gs->settings->num_modes);
+    }
+    //records are numbered from 1 in the output, as in --shard
+    if (gs->tag_records) {
+      VINA_FOR_IN(i, *j.results)
+        (*j.results)[i].addProperty("record",
+            boost::lexical_cast<std::string>(j.record + 1));
+    }
+
+    rendered_output* r = new rendered_output();
+    render_out(*j.results, *gs, *r);
+    r->score = j.results->empty() ?
+        -max_fl : j.results->front().score(gs->settings->sort_order);
+    if (gs->scorefile) {
+      std::stringstream row;
+      row << j.record + 1 << "," << csv_field(ms.front().get_name()) << ",";
+      if (j.results->empty())
+        row << ",,";
+      else
+        j.results->front().writeScores(row);
+      row << "\n";
+      r->scores = row.str();
+    }
+    if (buffered)
+      r->log = joblog.take();
+    delete j.results;
 
-    writer_job k(j.molid, j.results);
+    writer_job k(j.molid, j.record, r);
     writerq->push(k);
-    delete j.m;
+    delete j.ms;
   }
 }
 
-void write_out(std::vector<result_info> &results, ozfile &outfile,
-    std::string &outext,
-    user_settings &settings, const weighted_terms &wt, ozfile &outflex,
-    std::string &outfext, std::ofstream &atomoutfile)
+void write_out(const rendered_output &r, ozfile &outfile, ozfile &outflex,
+    std::ofstream &atomoutfile)
     {
+  metric_timer timer(MetricOutput);
   if (outfile)
-  {
-    //write out molecular data
-    for (unsigned j = 0, nr = results.size(); j < nr; j++) {
-      results[j].write(outfile, outext, settings.include_atom_info, &wt,
-          j + 1);
-    }
-  }
+    outfile.write(r.out.data(), r.out.size());
   if (outflex)
-  {
-    //write out flexible residue data data
-    for (unsigned j = 0, nr = results.size(); j < nr; j++) {
-      results[j].writeFlex(outflex, outfext, j + 1);
-    }
-  }
+    outflex.write(r.flex.data(), r.flex.size());
   if (atomoutfile)
-  {
-    for (unsigned j = 0, m = results.size(); j < m; j++) {
-      results[j].writeAtomValues(atomoutfile, &wt);
-    }
+    atomoutfile.write(r.atoms.data(), r.atoms.size());
+}
+
+//flush the outputs and record how far they go
+void save_checkpoint(const global_state &gs, checkpoint &progress,
+    ozfile &outfile, ozfile &outflex)
+    {
+  progress.out = outfile.tell();
+  progress.flex = outflex.tell();
+  if (gs.atomoutfile->is_open()) {
+    gs.atomoutfile->flush();
+    progress.atoms = gs.atomoutfile->tellp();
   }
+  if (gs.scorefile) {
+    gs.scorefile->flush();
+    progress.scores = gs.scorefile->tellp();
+  }
+  progress.write(gs.checkpoint_name);
 }
 
 //function for the writing thread to write ligands in order to output file
 void thread_a_writing(job_queue<writer_job>* writerq,
     global_state* gs,
-    ozfile* outfile, std::string* outext, ozfile* outflex,
-    std::string* outfext,
+    ozfile* outfile, ozfile* outflex,
     int* nligs) {
   try {
     int nwritten = 0;
-    boost::unordered_map<int, std::vector<result_info>*> proc_out;
+    boost::unordered_map<int, writer_job> proc_out;
+    checkpoint progress = gs->progress;
+    boost::timer::cpu_timer since_checkpoint;
+    std::priority_queue<ranked_output> top;
+
+    //write the next ligand in input order, or with top_k hold on to it if
+    //it is one of the best so far
+    auto write_next = [&](const writer_job& k) {
+      if (k.rendered->log.size() > 0)
+        gs->log->write(k.rendered->log);
+      if (gs->scorefile) {
+        metric_timer timer(MetricOutput);
+        gs->scorefile->write(k.rendered->scores.data(),
+            k.rendered->scores.size());
+      }
+      if (gs->top_k > 0) {
+        //only the poses are needed from here on
+        std::string().swap(k.rendered->log);
+        std::string().swap(k.rendered->scores);
+        top.push(ranked_output(k.rendered->score, k.molid, k.rendered));
+        if (top.size() > gs->top_k) {
+          delete top.top().rendered;
+          top.pop();
+        }
+      } else {
+        write_out(*k.rendered, *outfile, *outflex, *gs->atomoutfile);
+        delete k.rendered;
+      }
+      nwritten++;
+      progress.next_record = k.record + 1;
+    };
+
     writer_job j;
     while (!writerq->wait_and_pop(j))
     {
       if (j.molid == nwritten) {
-        write_out(*j.results, *outfile, *outext, *gs->settings, *gs->wt,
-            *outflex, *outfext, *gs->atomoutfile);
-        nwritten++;
-        delete j.results;
-        for (boost::unordered_map<int, std::vector<result_info>*>::iterator i;
+        write_next(j);
+        for (boost::unordered_map<int, writer_job>::iterator i;
             (i = proc_out.find(nwritten)) != proc_out.end();)
             {
-          write_out(*i->second, *outfile, *outext, *gs->settings,
-              *gs->wt, *outflex, *outfext, *gs->atomoutfile);
-          nwritten++;
-          delete i->second;
+          write_next(i->second);
+          proc_out.erase(i);
+        }
+        if (gs->checkpoint_name.size() > 0
+            && since_checkpoint.elapsed().wall / 1e9 >= gs->checkpoint_interval) {
+          save_checkpoint(*gs, progress, *outfile, *outflex);
+          since_checkpoint.start();
         }
       }
       else {
-        proc_out[j.molid] = j.results;
+        proc_out[j.molid] = j;
       }
     }
+
+    //best first
+    std::vector<ranked_output> best;
+    for (; !top.empty(); top.pop())
+      best.push_back(top.top());
+    for (sz i = best.size(); i-- > 0;) {
+      write_out(*best[i].rendered, *outfile, *outflex, *gs->atomoutfile);
+      delete best[i].rendered;
+    }
+
+    if (gs->checkpoint_name.size() > 0)
+      save_checkpoint(*gs, progress, *outfile, *outflex);
   } catch (file_error& e)
   {
     std::cerr << "\n\nError: could not open \"" << e.name.string()
@@ -1048,7 +1328,16 @@ Thank you!\n";
 
   try
   {
-    std::string rigid_name, flex_name, config_name, log_name, atom_name;
+    std::vector<std::string> rigid_names;
+    std::string flex_name, config_name, log_name, atom_name;
+    std::string metrics_name;
+    std::string receptor_cache_name;
+    std::string shard_spec;
+    std::string checkpoint_name;
+    std::string score_csv_name;
+    unsigned top_k = 0;
+    fl checkpoint_interval = 60;
+    bool resume = false;
     std::vector<std::string> ligand_names;
     std::string out_name;
     std::string outf_name;
@@ -1100,8 +1389,8 @@ Thank you!\n";
 
     options_description inputs("Input");
     inputs.add_options()
-    ("receptor,r", value<std::string>(&rigid_name),
-        "rigid part of the receptor")
+    ("receptor,r", value<std::vector<std::string> >(&rigid_names),
+        "rigid part of the receptor; if several are given each ligand is docked to every one and the best poses over the ensemble are kept")
     ("flex", value<std::string>(&flex_name),
         "flexible side chains, if any (PDBQT)")
     ("ligand,l", value<std::vector<std::string> >(&ligand_names),
@@ -1115,7 +1404,11 @@ Thank you!\n";
     ("flex_limit", value<int>(&flex_limit),
         "Hard limit for the number of flexible residues")
     ("flex_max", value<int>(&flex_max),
-        "Retain at at most the closest flex_max flexible residues");
+        "Retain at at most the closest flex_max flexible residues")
+    ("receptor_cache", value<std::string>(&receptor_cache_name),
+        "binary snapshot of the prepared receptor; used if it matches the receptor inputs, otherwise (re)written (not with flexres/flexdist)")
+    ("shard", value<std::string>(&shard_spec),
+        "k/N: only dock ligand records k, k+N, k+2N... (counting from 1 across all ligand files); output poses are tagged with their record, also counted from 1, for merging");
 
     //options_description search_area("Search area (required, except with --score_only)");
     options_description search_area("Search space (required)");
@@ -1142,13 +1435,25 @@ Thank you!\n";
     ("out_flex", value<std::string>(&outf_name),
         "output file for flexible receptor residues")
     ("log", value<std::string>(&log_name), "optionally, write log file")
+    ("metrics_out", value<std::string>(&metrics_name),
+        "optionally, write per-stage timings and call counts as JSON")
     ("atom_terms", value<std::string>(&atom_name),
         "optionally write per-atom interaction term values")
     ("atom_term_data",
         bool_switch(&settings.include_atom_info)->default_value(false),
         "embedded per-atom interaction terms in output sd data")
     ("pose_sort_order",value<pose_sort_order>(&settings.sort_order)->default_value(CNNscore),
-        "How to sort docking results: CNNscore (default), CNNaffinity, Energy");
+        "How to sort docking results: CNNscore (default), CNNaffinity, Energy")
+    ("top_k", value<unsigned>(&top_k)->default_value(0),
+        "only write the best top_k ligands by pose_sort_order over the whole run, best first, once all are done (0 writes all)")
+    ("score_csv", value<std::string>(&score_csv_name),
+        "optionally write the scores of the best pose of every ligand as CSV")
+    ("checkpoint", value<std::string>(&checkpoint_name),
+        "file in which to periodically record the progress of the run for --resume")
+    ("checkpoint_interval", value<fl>(&checkpoint_interval)->default_value(60),
+        "seconds between checkpoints")
+    ("resume", bool_switch(&resume)->default_value(false),
+        "continue the run recorded in --checkpoint: outputs are cut back to the checkpoint and ligands already written are skipped");
 
     options_description scoremin("Scoring and minimization options");
     scoremin.add_options()
@@ -1170,6 +1475,18 @@ Thank you!\n";
         "number of monte carlo steps to take in each chain")
     ("num_mc_saved", value<int>(&settings.num_mc_saved),
             "number of top poses saved in each monte carlo chain")
+    ("mc_stall_steps", value<int>(&settings.mc_stall_steps)->default_value(0),
+        "end a monte carlo chain early after this many steps without improvement (0 disables)")
+    ("mc_agree_chains", value<int>(&settings.mc_agree_chains)->default_value(0),
+        "end the search early once this many (at least 2) monte carlo chains have found the same best pose (0 disables); results then depend on thread timing and are not reproducible with --seed")
+    ("mc_reseed_steps", value<int>(&settings.mc_reseed_steps)->default_value(0),
+        "restart a monte carlo chain that has not improved in this many steps from one of the best poses found by any chain (0 disables); results then depend on thread timing and are not reproducible with --seed")
+    ("mc_prescreen", value<fl>(&settings.mc_prescreen)->default_value(0),
+        "skip minimizing monte carlo mutations that raise the unminimized energy by more than this (0 disables)")
+    ("mc_granularity", value<fl>(&settings.mc_granularity)->default_value(0),
+        "grid spacing in Angstroms used by the monte carlo search; final poses are always refined off-grid (0 uses the default 0.375)")
+    ("grid_bf16", bool_switch(&settings.grid_bf16),
+        "store the monte carlo search grid at bfloat16 precision, halving its memory (not with --gpu_docking)")
     ("minimize_iters",
         value<unsigned>(&minparms.maxiters)->default_value(0),
         "number iterations of steepest descent; default scales with rotors and usually isn't sufficient for convergence")
@@ -1219,6 +1536,8 @@ Thank you!\n";
         "caffe cnn model file; if not specified a default model will be used")
     ("cnn_weights", value<std::vector<std::string>>(&cnnopts.cnn_weights)->multitoken(),
         "caffe cnn weights file (*.caffemodel); if not specified default weights (trained on the default model) will be used")
+    ("cnn_bundle", value<std::string>(&cnnopts.cnn_bundle_file),
+        "precompiled bundle of the built-in models for faster startup; created if it does not exist and rebuilt if the models have changed")
     ("cnn_resolution", value<fl>(&cnnopts.resolution)->default_value(0.5),
         "resolution of grids, don't change unless you really know what you are doing")
     ("cnn_rotation", value<unsigned>(&cnnopts.cnn_rotations)->default_value(0),
@@ -1246,6 +1565,8 @@ Thank you!\n";
         "Y coordinate of the CNN center")
     ("cnn_center_z", value<fl>(&cnnopts.cnn_center[2]),
         "Z coordinate of the CNN center")
+    ("cnn_int8", bool_switch(&cnnopts.quantize_int8),
+        "Approximate CNN convolutions and inner products with int8 arithmetic on the CPU (faster, scores change slightly)")
     ("cnn_verbose", bool_switch(&cnnopts.verbose),
         "Enable verbose output for CNN debugging");
 
@@ -1259,6 +1580,12 @@ Thank you!\n";
         "exhaustiveness of the global search (roughly proportional to time)")
     ("num_modes", value<sz>(&settings.num_modes)->default_value(9),
         "maximum number of binding modes to generate")
+    ("screen_fraction", value<fl>(&settings.screen_fraction)->default_value(1.0),
+        "screening mode: only give the full search to ligands whose short initial search ranks within this top fraction (1 disables, single receptor only)")
+    ("screen_effort", value<fl>(&settings.screen_effort)->default_value(0.1),
+        "fraction of the Monte Carlo steps used for the initial search in screening mode")
+    ("screen_warmup", value<sz>(&settings.screen_warmup)->default_value(100),
+        "number of initial ligands that always get the full search in screening mode")
     ("min_rmsd_filter", value<fl>(&settings.out_min_rmsd)->default_value(1.0),
         "rmsd value used to filter final poses to remove redundancy")
     ("quiet,q", bool_switch(&quiet), "Suppress output messages")
@@ -1337,6 +1664,12 @@ Thank you!\n";
     if (vm.count("log") > 0)
       log.init(log_name);
 
+    std::unique_ptr<ofile> metrics_file;
+    if (metrics_name.size() > 0) {
+      metrics_file.reset(new ofile(metrics_name)); //fail before doing any work
+      metrics::enable();
+    }
+
     if (!atomconstants_file.empty())
       setup_atomconstants_from_file(atomconstants_file);
 
@@ -1419,6 +1752,11 @@ Thank you!\n";
       settings.sort_order = Energy;
     }
 
+    //dx output runs the nets in ways that need every blob to itself
+    cnnopts.share_memory = !cnnopts.outputdx;
+    cnnopts.inference_only = cnnopts.cnn_scoring <= CNNrescore
+        && !cnnopts.outputdx && !cnnopts.outputxyz && !cnnopts.gradient_check;
+
     if (receptor_needed)
     {
       if (vm.count("receptor") <= 0)
@@ -1453,6 +1791,21 @@ Thank you!\n";
       throw usage_error("exhaustiveness must be 1 or greater");
     if (settings.num_modes < 1)
       throw usage_error("num_modes must be 1 or greater");
+    if (settings.screen_fraction <= 0 || settings.screen_fraction > 1)
+      throw usage_error("screen_fraction must be in (0,1]");
+    if (settings.screen_effort <= 0 || settings.screen_effort > 1)
+      throw usage_error("screen_effort must be in (0,1]");
+    if (settings.mc_stall_steps < 0 || settings.mc_agree_chains < 0
+        || settings.mc_reseed_steps < 0)
+      throw usage_error("mc_stall_steps, mc_agree_chains and mc_reseed_steps must be non-negative");
+    if (settings.mc_agree_chains == 1)
+      throw usage_error("mc_agree_chains must be at least 2, a chain always agrees with itself");
+    if (settings.mc_prescreen < 0)
+      throw usage_error("mc_prescreen must be non-negative");
+    if (settings.mc_granularity < 0)
+      throw usage_error("mc_granularity must be non-negative");
+    if (settings.grid_bf16 && settings.gpu_docking)
+      throw usage_error("grid_bf16 is not supported with gpu_docking");
 
     boost::optional<std::string> flex_name_opt;
     if (vm.count("flex"))
@@ -1461,6 +1814,32 @@ Thank you!\n";
     if (vm.count("flex") && !vm.count("receptor"))
       throw usage_error(
           "Flexible side chains are not allowed without the rest of the receptor"); // that's the only way parsing works, actually
+    if (rigid_names.size() > 1 && vm.count("flex"))
+      throw usage_error("--flex is for a single receptor, use --flexres or --flexdist with an ensemble");
+    if (rigid_names.size() > 1 && receptor_cache_name.size() > 0)
+      throw usage_error("--receptor_cache is for a single receptor");
+    //the filter ranks ligands, but with an ensemble it would be asked once
+    //per receptor and could give a ligand the full search on only some
+    if (rigid_names.size() > 1 && settings.screen_fraction < 1)
+      throw usage_error("--screen_fraction is for a single receptor");
+    if (rigid_names.empty())
+      rigid_names.push_back(""); //no receptor is an empty one
+
+    if (resume && checkpoint_name.size() == 0)
+      throw usage_error("--resume requires --checkpoint");
+    if (checkpoint_interval < 0)
+      throw usage_error("checkpoint_interval must be non-negative");
+    if (top_k > 0 && checkpoint_name.size() > 0)
+      throw usage_error("--top_k ligands are only written at the end of the run, so it cannot be checkpointed");
+
+    unsigned shard = 0, nshards = 0;
+    if (shard_spec.size() > 0) {
+      std::istringstream shardin(shard_spec);
+      char slash = 0;
+      if (!(shardin >> shard >> slash >> nshards) || slash != '/'
+          || !(shardin >> std::ws).eof() || shard < 1 || shard > nshards)
+        throw usage_error("shard must be k/N with 1 <= k <= N");
+    }
 
     if(flex_limit > -1 && flex_max > -1){
       throw usage_error(
@@ -1475,9 +1854,20 @@ Thank you!\n";
       nflex_hard_limit = false;
     }
 
+    //progress of the run being resumed, if any
+    checkpoint progress;
+    bool resumed = resume && progress.read(checkpoint_name);
+
     std::ofstream atomoutfile;
     if (vm.count("atom_terms") > 0)
-      atomoutfile.open(atom_name.c_str());
+      open_output(atomoutfile, atom_name, resumed ? progress.atoms : -1);
+
+    std::ofstream scorefile;
+    if (score_csv_name.size() > 0) {
+      open_output(scorefile, score_csv_name, resumed ? progress.scores : -1);
+      if (!resumed || progress.scores == 0)
+        scorefile << "record,name,minimizedAffinity,CNNscore,CNNaffinity\n";
+    }
 
     //output banner
     log << cite_message << '\n';
@@ -1493,13 +1883,58 @@ Thank you!\n";
     }
     log << "\n";
 
-    FlexInfo finfo(flex_res, flex_dist, flexdist_ligand, nflex, nflex_hard_limit, log);
+    //each receptor of an ensemble selects its own flexible residues
+    boost::ptr_vector<FlexInfo> finfos;
+    VINA_FOR_IN(r, rigid_names)
+      finfos.push_back(new FlexInfo(flex_res, flex_dist, flexdist_ligand, nflex, nflex_hard_limit, log));
+    const FlexInfo& finfo = finfos[0];
     // dkoes - parse in receptor once
-    MolGetter mols(rigid_name, flex_name, finfo, add_hydrogens, strip_hydrogens, log);
+    MolGetter mols(add_hydrogens, strip_hydrogens);
+    {
+      metric_timer timer(MetricReceptorSetup);
+      boost::shared_ptr<receptor_cache> rcache;
+      if (receptor_cache_name.size() > 0 && finfo.hasContent()) {
+        //the snapshot does not include the extracted flexible residues
+        log << "WARNING: --receptor_cache ignored with --flexres or --flexdist\n\n";
+      } else if (receptor_cache_name.size() > 0) {
+        rcache.reset(new receptor_cache(receptor_cache_name));
+        rcache->add_dependency(rigid_names[0]);
+        rcache->add_dependency(flex_name);
+        rcache->add_setting("addH", add_hydrogens);
+        rcache->add_setting("stripH", strip_hydrogens);
+      }
+      VINA_FOR_IN(r, rigid_names)
+        mols.create_init_model(rigid_names[r], flex_name, finfos[r], log,
+            rcache.get());
+    }
+    if (nshards > 0)
+      mols.setShard(shard - 1, nshards);
+    if (resumed) {
+      log << "Resuming from input record " << progress.next_record + 1 << "\n";
+      mols.setFirstRecord(progress.next_record);
+    }
 
     if (autobox_ligand.length() > 0) {
       setup_autobox(mols.getInitModel(),autobox_ligand, autobox_add,
           center_x, center_y, center_z, size_x, size_y, size_z);
+      //the box must cover the flexible residues of every receptor
+      for (sz r = 1; r < mols.num_receptors(); r++) {
+        fl cx, cy, cz, sx, sy, sz_;
+        setup_autobox(mols.getInitModel(r), autobox_ligand, autobox_add,
+            cx, cy, cz, sx, sy, sz_);
+        fl lo[3] = { std::min(center_x - size_x / 2, cx - sx / 2),
+            std::min(center_y - size_y / 2, cy - sy / 2),
+            std::min(center_z - size_z / 2, cz - sz_ / 2) };
+        fl hi[3] = { std::max(center_x + size_x / 2, cx + sx / 2),
+            std::max(center_y + size_y / 2, cy + sy / 2),
+            std::max(center_z + size_z / 2, cz + sz_ / 2) };
+        center_x = (lo[0] + hi[0]) / 2;
+        center_y = (lo[1] + hi[1]) / 2;
+        center_z = (lo[2] + hi[2]) / 2;
+        size_x = hi[0] - lo[0];
+        size_y = hi[1] - lo[1];
+        size_z = hi[2] - lo[2];
+      }
     }
 
     if (search_box_needed && autobox_ligand.length() == 0)  {
@@ -1565,7 +2000,10 @@ Thank you!\n";
 
     // Print out flexible residues 
     if(finfo.hasContent()){
-      finfo.printFlex();
+      VINA_FOR_IN(r, finfos) {
+        if (finfos.size() > 1) log << "Receptor " << rigid_names[r] << "\n";
+        finfos[r].printFlex();
+      }
     }
     
     // Print information about flexible residues use
@@ -1632,14 +2070,21 @@ Thank you!\n";
     ozfile outfile;
     std::string outext;
     if (out_name.length() > 0) {
-      outext = outfile.open(out_name);
+      outext = outfile.open(out_name, resumed ? progress.out : -1,
+          settings.cpu);
+      //output is formatted by the workers, so check the format up front
+      if (!OBConversion().FormatFromExt(outext))
+        throw usage_error("Invalid format: " + outext);
     }
 
     ozfile outflex;
     std::string outfext;
     if (outf_name.length() > 0)
     {
-      outfext = outflex.open(outf_name);
+      outfext = outflex.open(outf_name, resumed ? progress.flex : -1,
+          settings.cpu);
+      if (!OBConversion().FormatFromExt(outfext))
+        throw usage_error("Invalid format: " + outfext);
     }
 
     if (settings.score_only) //output header
@@ -1662,8 +2107,23 @@ Thank you!\n";
     job_queue<writer_job> writerq;
     int nligs = 0;
     size_t nthreads = settings.cpu;
+    screening_filter screen(settings.screen_fraction, settings.screen_warmup);
     global_state gs(&settings, prec, &minparms, &wt, &user_grid,
-        &log, &atomoutfile, cnnopts);
+        &log, &atomoutfile, cnnopts, &screen, outext, outfext);
+    if (rigid_names.size() > 1)
+      gs.receptors = rigid_names;
+    gs.tag_records = nshards > 0;
+    gs.checkpoint_name = checkpoint_name;
+    gs.checkpoint_interval = checkpoint_interval;
+    gs.progress = progress;
+    gs.top_k = top_k;
+    if (scorefile.is_open())
+      gs.scorefile = &scorefile;
+    if (settings.score_only || settings.local_only) {
+      VINA_FOR(r, mols.num_receptors())
+        gs.cells.push_back(boost::shared_ptr<receptor_cells>(
+            new receptor_cells(mols.getInitModel(r), prec->cutoff_sqr())));
+    }
     boost::thread_group worker_threads;
     boost::timer::cpu_timer time;
     CNNScorer cnn_scorer(cnnopts); //shared network
@@ -1679,10 +2139,11 @@ Thank you!\n";
 
     //launch writer thread to write results wherever they go
     boost::thread writer_thread(thread_a_writing, &writerq, &gs, &outfile,
-        &outext, &outflex, &outfext, &nligs);
+        &outflex, &nligs);
 
     try {
       //loop over input ligands, adding them to the work queue
+      mols.setThreads(settings.cpu);
       for (unsigned l = 0, nl = ligand_names.size(); l < nl; l++) {
         doing(settings.verbosity, "Reading input", log);
         const std::string ligand_name = ligand_names[l];
@@ -1691,15 +2152,25 @@ Thank you!\n";
         unsigned i = 0;
 
         for (;;)  {
-          model* m = new model;
+          std::vector<model>* ms = new std::vector<model>();
 
-          if (!mols.readMoleculeIntoModel(*m))  {
-            delete m;
+          bool read = false;
+          {
+            metric_timer timer(MetricRead);
+            read = mols.readMoleculeIntoModels(*ms);
+          }
+          if (!read)  {
+            delete ms;
             break;
           }
-          m->set_pose_num(i);
-          m->gdata.device_on = settings.gpu_docking;
-          m->gdata.device_id = settings.device;
+          VINA_FOR_IN(r, *ms) {
+            model& mr = (*ms)[r];
+            mr.set_pose_num(i);
+            mr.gdata.device_on = settings.gpu_docking;
+            mr.gdata.device_id = settings.device;
+          }
+          //the ligand, which fixes the box, is the same for every receptor
+          model* m = &ms->front();
 
           grid_dims gdbox(gd);
           if (settings.local_only)
@@ -1714,8 +2185,10 @@ Thank you!\n";
                 break;
               }
             }
-            if(skip)
+            if(skip) {
+              delete ms;
               continue;
+            }
           } else if(autobox_extend) {
             //make sure every dimension is large enough for the ligand to fit
             fl maxdim = m->max_span(0);
@@ -1728,7 +2201,7 @@ Thank you!\n";
           done(settings.verbosity, log);
           std::vector<result_info>* results =
               new std::vector<result_info>();
-          worker_job j(i, m, results, gdbox);
+          worker_job j(i, mols.recordIndex(), ms, results, gdbox);
           wrkq.push(j);
 
           i++;
@@ -1763,7 +2236,9 @@ Thank you!\n";
 
     cudaDeviceSynchronize();
 
-    //std::cout << "Loop time " << time.elapsed().wall / 1000000000.0 << "\n";
+    if (metrics_file) {
+      metrics::write_json(*metrics_file);
+    }
 
   } catch (file_error& e)
   {
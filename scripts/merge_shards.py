@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+
+"""
+Combine the sdf outputs of a screen run as several gnina jobs with --shard k/N
+into a single file, either in the order of the input records or keeping only
+the best top_k ligands.
+
+Every pose written with --shard carries a record data field with the position
+of its ligand in the input, counting from 1 as --shard does, and each shard
+output is in increasing record order, so the shards can be merged while
+streaming.
+"""
+
+import argparse, gzip, heapq, itertools, sys
+
+parser = argparse.ArgumentParser(description="Merge gnina --shard outputs.")
+parser.add_argument("shards", nargs="+", help="Shard outputs (sdf or sdf.gz)")
+parser.add_argument("-o", "--out", default="-", help="Output file name (sdf or sdf.gz), stdout by default")
+parser.add_argument("--top_k", type=int, default=0,
+                    help="Only output the best top_k ligands, best first")
+parser.add_argument("--pose_sort_order", default="CNNscore",
+                    choices=["CNNscore", "CNNaffinity", "Energy"],
+                    help="How ligands are ranked for --top_k, by their first pose")
+args = parser.parse_args()
+
+
+def openfile(name, mode):
+    if name == "-":
+        return sys.stdin if "r" in mode else sys.stdout
+    if name.endswith(".gz"):
+        return gzip.open(name, mode + "t")
+    return open(name, mode)
+
+
+def molecules(f):
+    """Yield the text of each molecule of an sdf file."""
+    lines = []
+    for line in f:
+        lines.append(line)
+        if line.startswith("$$$$"):
+            yield "".join(lines)
+            lines = []
+
+
+def field(mol, name):
+    """Return the value of data field name of mol, or None."""
+    tag = "> <%s>" % name
+    lines = mol.split("\n")
+    for i, line in enumerate(lines):
+        if line.startswith(tag) and i + 1 < len(lines):
+            return lines[i + 1].strip()
+    return None
+
+
+def ligands(fname):
+    """Yield (record, poses) of each ligand of a shard output."""
+    with openfile(fname, "r") as f:
+        for record, poses in itertools.groupby(molecules(f), lambda m: field(m, "record")):
+            if record is None:
+                sys.exit("%s has poses without a record field, was it written with --shard?" % fname)
+            yield int(record), list(poses)
+
+
+def score(poses):
+    """Score of a ligand by its first pose, larger is better."""
+    if args.pose_sort_order == "Energy":
+        value = field(poses[0], "minimizedAffinity")
+        return -float(value) if value is not None else -float("inf")
+    value = field(poses[0], args.pose_sort_order)
+    return float(value) if value is not None else -float("inf")
+
+
+merged = heapq.merge(*[ligands(name) for name in args.shards], key=lambda lig: lig[0])
+
+out = openfile(args.out, "w")
+if args.top_k > 0:
+    # min heap of the best ligands seen so far, ties go to the earlier record
+    best = []
+    for record, poses in merged:
+        item = (score(poses), -record, poses)
+        if len(best) < args.top_k:
+            heapq.heappush(best, item)
+        elif item[:2] > best[0][:2]:
+            heapq.heapreplace(best, item)
+    for s, record, poses in sorted(best, key=lambda item: item[:2], reverse=True):
+        out.write("".join(poses))
+else:
+    for record, poses in merged:
+        out.write("".join(poses))
+out.close()
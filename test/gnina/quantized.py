@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+
+'''Compare --cnn_int8 CNN scoring against full precision on the CPU.
+Docks each test complex once, then rescores the poses with and without
+--cnn_int8 and reports how well the reduced precision scores track the
+full precision ones along with the time taken by each.'''
+
+import argparse, os, re, subprocess, sys, tempfile, time
+import numpy as np
+from scipy.stats import pearsonr, spearmanr
+
+parser = argparse.ArgumentParser(description=__doc__)
+parser.add_argument('gnina', help='gnina executable')
+parser.add_argument('--complexes', nargs='+', default=['184l', '10gs', '3rod'],
+        help='prefixes of data/*_rec.pdb and data/*_lig.{sdf,pdb} to use')
+parser.add_argument('--cpu', type=int, default=0,
+        help='threads for gnina; 0 to let gnina decide')
+parser.add_argument('--cnn', default='', help='built-in model (default ensemble if empty)')
+args = parser.parse_args()
+
+datadir = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'data')
+
+def ligand_file(prefix):
+    for ext in ('sdf', 'pdb'):
+        fname = os.path.join(datadir, '%s_lig.%s' % (prefix, ext))
+        if os.path.exists(fname):
+            return fname
+    sys.exit('No ligand for %s' % prefix)
+
+def run(*opts):
+    cmd = [args.gnina, '--no_gpu'] + list(opts)
+    if args.cpu:
+        cmd += ['--cpu', str(args.cpu)]
+    if args.cnn:
+        cmd += ['--cnn', args.cnn]
+    start = time.time()
+    out = subprocess.check_output(cmd).decode()
+    return out, time.time() - start
+
+def getscores(out):
+    '''CNNscore and CNNaffinity of every scored pose'''
+    scores = [float(s) for s in re.findall(r'CNNscore: (\S+)', out)]
+    affs = [float(a) for a in re.findall(r'CNNaffinity: (\S+)', out)]
+    return np.array(scores), np.array(affs)
+
+fp32 = ([], [])
+int8 = ([], [])
+times = {'fp32': 0.0, 'int8': 0.0}
+tmpdir = tempfile.mkdtemp()
+
+for prefix in args.complexes:
+    rec = os.path.join(datadir, '%s_rec.pdb' % prefix)
+    lig = ligand_file(prefix)
+    poses = os.path.join(tmpdir, '%s_docked.sdf' % prefix)
+    run('-r', rec, '-l', lig, '--autobox_ligand', lig, '--seed', '2',
+            '--num_modes', '9', '-o', poses)
+
+    for name, result, extra in (('fp32', fp32, []), ('int8', int8, ['--cnn_int8'])):
+        out, elapsed = run('-r', rec, '-l', poses, '--score_only', *extra)
+        times[name] += elapsed
+        s, a = getscores(out)
+        result[0].extend(s)
+        result[1].extend(a)
+
+for i, label in enumerate(('CNNscore', 'CNNaffinity')):
+    full = np.array(fp32[i])
+    approx = np.array(int8[i])
+    assert len(full) == len(approx) and len(full) > 1
+    print('%-12s poses %d  pearson %.4f  spearman %.4f  max abs diff %.4f  mean abs diff %.4f' %
+            (label, len(full), pearsonr(full, approx)[0], spearmanr(full, approx)[0],
+             np.max(np.abs(full - approx)), np.mean(np.abs(full - approx))))
+
+print('rescoring time fp32 %.2fs  int8 %.2fs  speedup %.2fx' %
+        (times['fp32'], times['int8'], times['fp32'] / times['int8']))
@@ -5,31 +5,21 @@ import numpy as np
 import itertools
 import matplotlib.pyplot as plt
 from plumbum import local
-import os, gzip, sys, math
+import os, gzip, sys, math, time
 from rdkit import Chem
 from rdkit.Chem import rdMolDescriptors as rdMD
 
 plt.style.use('seaborn-white')
 
-def get_time(out):
+def get_time(cmd, *args):
     '''
-    Returns loop time for gnina run; does this by parsing the stdout to get the
-    value computed by the internal loop timer. This might be a crappy way of
-    doing things (e.g. what if we decide to disable timer printing?) so
-    probably this should be changed to use /usr/bin/time or a python timing
-    utility
+    Returns the wall clock time of a gnina run. gnina no longer prints its
+    internal loop timer, so time the whole process; use gnina_bench for
+    per-stage numbers.
     '''
-    tstring = ''
-    
-    for char in out:
-        if char == "\n":
-            if tstring.startswith('Loop time'):
-                return float(tstring.split()[-1])
-                break
-            else:
-                tstring = ''
-        else:
-            tstring = tstring + char
+    start = time.time()
+    run_command(cmd, *args)
+    return time.time() - start
 
 def get_torsions(ligand):
     '''
@@ -172,15 +162,13 @@ for idx,bin in enumerate(args.input):
             if run==0 and lignum==0: gpu_time = [[0] * 3 for
                     i in range(len(args.ligands))]
             if args.cpu and idx == 0:
-                out = run_command(args.cpu, '-r', args.receptor, '-l', ligand, '--minimize')
-                cpu_time[lignum][run] = get_time(out)
+                cpu_time[lignum][run] = get_time(args.cpu, '-r', args.receptor,
+                        '-l', ligand, '--minimize')
             elif args.paired_test or not args.paired_test and idx == 0:
-                out = run_command(bin, '-r', args.receptor, '-l', ligand,
-                        '--minimize')
-                cpu_time[lignum][run] = get_time(out)
-            out = run_command(bin, '-r', args.receptor, '-l', ligand, '--minimize',
-            '--gpu', '--cpu', '3')
-            gpu_time[lignum][run] = get_time(out)
+                cpu_time[lignum][run] = get_time(bin, '-r', args.receptor,
+                        '-l', ligand, '--minimize')
+            gpu_time[lignum][run] = get_time(bin, '-r', args.receptor, '-l',
+                    ligand, '--minimize', '--gpu', '--cpu', '3')
 
     torsions_speedup[bin] = []
     torsions_err[bin] = []
@@ -0,0 +1,147 @@
+#include <random>
+#include <sstream>
+#include <string>
+#include "bgzf.h"
+#include "test_bgzf.h"
+#include "test_utils.h"
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+namespace io = boost::iostreams;
+
+//text-like data that compresses, mixed with runs of random bytes that don't
+static std::string make_data(std::mt19937& engine, size_t n) {
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::uniform_int_distribution<int> word(0, 15);
+  std::uniform_int_distribution<int> run(1, 4096);
+  std::string data;
+  while (data.size() < n) {
+    int len = run(engine);
+    if (word(engine) < 4) {
+      for (int i = 0; i < len; i++)
+        data += char(byte(engine));
+    } else {
+      for (int i = 0; i < len; i += 8)
+        data += "ATOM " + std::to_string(word(engine)) + "\n";
+    }
+  }
+  data.resize(n);
+  return data;
+}
+
+//write data in randomly sized pieces to a BGZF stream
+static std::string bgzf_compress(std::mt19937& engine, const std::string& data,
+    unsigned threads) {
+  std::ostringstream out;
+  {
+    io::filtering_ostream z;
+    z.push(bgzf_compressor(out, threads));
+    std::uniform_int_distribution<size_t> piece(1, 100000);
+    for (size_t pos = 0; pos < data.size();) {
+      size_t n = std::min(piece(engine), data.size() - pos);
+      z.write(data.data() + pos, n);
+      pos += n;
+    }
+  }
+  return out.str();
+}
+
+static std::string gzip_compress(const std::string& data) {
+  std::ostringstream out;
+  {
+    io::filtering_ostream z;
+    z.push(io::gzip_compressor());
+    z.push(out);
+    z << data;
+  }
+  return out.str();
+}
+
+//read all of compressed, errors are thrown
+static std::string decompress(const std::string& compressed, unsigned threads) {
+  std::istringstream in(compressed);
+  io::filtering_istream z;
+  z.push(bgzf_decompressor(in, threads));
+  z.exceptions(std::ios::badbit);
+  std::ostringstream out;
+  io::copy(z, out);
+  return out.str();
+}
+
+void test_bgzf_roundtrip() {
+  p_args.log << "BGZF Round Trip Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << '\n';
+  p_args.log << "Iteration " << p_args.iter_count << '\n';
+  std::mt19937 engine(p_args.seed);
+
+  //empty, less than one block, exactly one block and many blocks
+  size_t sizes[] = { 0, 1000, 0xff00, 1000000 };
+  for (size_t n : sizes) {
+    std::string data = make_data(engine, n);
+    std::string compressed = bgzf_compress(engine, data, 3);
+    std::istringstream in(compressed);
+    BOOST_CHECK(is_bgzf(in));
+    BOOST_CHECK(decompress(compressed, 1) == data);
+    BOOST_CHECK(decompress(compressed, 4) == data);
+
+    //it is still an ordinary gzip file
+    std::istringstream gzin(compressed);
+    io::filtering_istream z;
+    z.push(io::gzip_decompressor());
+    z.push(gzin);
+    std::ostringstream out;
+    io::copy(z, out);
+    BOOST_CHECK(out.str() == data);
+  }
+}
+
+void test_bgzf_multi_member() {
+  p_args.log << "BGZF Multiple Member Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << '\n';
+  p_args.log << "Iteration " << p_args.iter_count << '\n';
+  std::mt19937 engine(p_args.seed);
+
+  //concatenated files, as from cat, including a plain gzip member in the
+  //middle that has to be decompressed serially
+  std::string a = make_data(engine, 200000);
+  std::string b = make_data(engine, 50000);
+  std::string c = make_data(engine, 300000);
+  std::string compressed = bgzf_compress(engine, a, 2) + gzip_compress(b)
+      + bgzf_compress(engine, c, 2);
+  BOOST_CHECK(decompress(compressed, 2) == a + b + c);
+}
+
+void test_bgzf_truncated() {
+  p_args.log << "BGZF Truncated File Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << '\n';
+  p_args.log << "Iteration " << p_args.iter_count << '\n';
+  std::mt19937 engine(p_args.seed);
+
+  std::string data = make_data(engine, 500000);
+  std::string compressed = bgzf_compress(engine, data, 2);
+  //cut inside the last data block, in front of the end of file marker
+  std::string truncated = compressed.substr(0, compressed.size() - 28 - 10);
+  BOOST_CHECK_THROW(decompress(truncated, 2), std::exception);
+
+  //a member claiming to hold more than a block is corrupt
+  std::string big = bgzf_compress(engine, make_data(engine, 100), 1);
+  size_t isize = big.size() - 28 - 4; //last field of the data block
+  big[isize + 2] = 1; //isize += 65536
+  BOOST_CHECK_THROW(decompress(big, 1), std::exception);
+}
+
+void test_bgzf_plain_gzip() {
+  p_args.log << "BGZF Plain Gzip Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << '\n';
+  p_args.log << "Iteration " << p_args.iter_count << '\n';
+  std::mt19937 engine(p_args.seed);
+
+  std::string data = make_data(engine, 300000);
+  std::string compressed = gzip_compress(data);
+  std::istringstream in(compressed);
+  BOOST_CHECK(!is_bgzf(in));
+  BOOST_CHECK(decompress(compressed, 2) == data);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+void test_bgzf_roundtrip();
+void test_bgzf_multi_member();
+void test_bgzf_truncated();
+void test_bgzf_plain_gzip();
@@ -4,6 +4,7 @@
 #include "test_cnn.h"
 #include "atom_constants.h"
 #include "cnn_scorer.h"
+#include "molgetter.h"
 #include <cuda_runtime.h>
 #include "quaternion.h"
 #include "caffe/proto/caffe.pb.h"
@@ -145,6 +146,62 @@ void test_vanilla_grids() {
   }
 }
 
+//score the 10gs crystal ligand against its receptor on the cpu
+static void score_10gs(const cnn_options& cnnopts, float& score,
+    float& affinity) {
+  FlexInfo finfo(p_args.log);
+  MolGetter mols;
+  mols.create_init_model(TEST_DATA_DIR "/10gs_rec.pdb", "", finfo, p_args.log);
+  mols.setInputFile(TEST_DATA_DIR "/10gs_lig.sdf");
+  model m;
+  BOOST_REQUIRE(mols.readMoleculeIntoModel(m));
+
+  CNNScorer cnn_scorer(cnnopts);
+  cnn_scorer.set_center_from_model(m);
+  float loss = 0, variance = 0;
+  score = cnn_scorer.score(m, false, affinity, loss, variance);
+}
+
+void test_simplified_net() {
+  //folding batch norms and skipping empty channels must not change the
+  //scores of the default models
+  p_args.log << "CNN Simplified Net Test \n";
+  Caffe::set_mode(Caffe::CPU);
+
+  cnn_options cnnopts;
+  float score = 0, affinity = 0;
+  score_10gs(cnnopts, score, affinity);
+
+  cnnopts.simplify_net = false;
+  float refscore = 0, refaffinity = 0;
+  score_10gs(cnnopts, refscore, refaffinity);
+
+  p_args.log << "Simplified " << score << " " << affinity << " Original "
+      << refscore << " " << refaffinity << "\n";
+  BOOST_REQUIRE_SMALL(score - refscore, 0.001f);
+  BOOST_REQUIRE_SMALL(affinity - refaffinity, 0.001f + 0.0001f * std::fabs(refaffinity));
+}
+
+void test_inference_only() {
+  //sharing activation memory when only rescoring must not change scores
+  p_args.log << "CNN Inference Only Test \n";
+  Caffe::set_mode(Caffe::CPU);
+
+  cnn_options cnnopts;
+  cnnopts.inference_only = true;
+  float score = 0, affinity = 0;
+  score_10gs(cnnopts, score, affinity);
+
+  cnnopts.inference_only = false;
+  float refscore = 0, refaffinity = 0;
+  score_10gs(cnnopts, refscore, refaffinity);
+
+  p_args.log << "Inference only " << score << " " << affinity << " Default "
+      << refscore << " " << refaffinity << "\n";
+  BOOST_REQUIRE_SMALL(score - refscore, 0.0001f);
+  BOOST_REQUIRE_SMALL(affinity - refaffinity, 0.0001f);
+}
+
 //TODO TODO TODO: reimplement this functionality
 #if 0
 void test_subcube_grids() {
@@ -2,5 +2,7 @@
 
 void test_set_atom_gradients();
 void test_vanilla_grids();
+void test_simplified_net();
+void test_inference_only();
 void test_subcube_grids();
 void test_strided_cube_datagetter();
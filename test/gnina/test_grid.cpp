@@ -0,0 +1,192 @@
+#include <random>
+#include <cmath>
+#include <cfloat>
+#include <limits>
+#include "common.h"
+#include "bfloat16.h"
+#include "model.h"
+#include "cache.h"
+#include "molgetter.h"
+#include "custom_terms.h"
+#include "weighted_terms.h"
+#include "precalculate.h"
+#include "naive_non_cache.h"
+#include "test_grid.h"
+#include "test_utils.h"
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+void test_grid_bf16() {
+  p_args.log << "Compact Grid Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << "\n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+  rng generator(static_cast<rng::result_type>(p_args.seed));
+
+  //finite floats stay finite, infinities and nans are kept
+  const float inf = std::numeric_limits<float>::infinity();
+  const float largest = float(bfloat16(FLT_MAX));
+  BOOST_REQUIRE(largest < inf && largest > 3.38e38f);
+  BOOST_REQUIRE_EQUAL(float(bfloat16(-FLT_MAX)), -largest);
+  BOOST_REQUIRE_EQUAL(float(bfloat16(inf)), inf);
+  BOOST_REQUIRE_EQUAL(float(bfloat16(-inf)), -inf);
+  BOOST_REQUIRE(std::isnan(float(bfloat16(std::nanf("")))));
+  BOOST_REQUIRE_EQUAL(float(bfloat16(1.5f)), 1.5f);
+
+  custom_terms t;
+  t.add("gauss(o=0,_w=0.5,_c=8)", -0.035579);
+  t.add("gauss(o=3,_w=2,_c=8)", -0.005156);
+  t.add("repulsion(o=0,_c=8)", 0.840245);
+  t.add("hydrophobic(g=0.5,_b=1.5,_c=8)", -0.035069);
+  t.add("non_dir_h_bond(g=-0.7,_b=0,_c=8)", -0.587439);
+  weighted_terms wt(&t, t.weights());
+  precalculate_splines prec(wt, 10);
+  const vec v(10, 1.5, 10);
+  const fl granularity = 0.375;
+  const fl slope = 10;
+
+  //the 184l complex, with a grid around the ligand as for docking
+  FlexInfo finfo(p_args.log);
+  MolGetter mols;
+  mols.create_init_model(TEST_DATA_DIR "/184l_rec.pdb", "", finfo, p_args.log);
+  mols.setInputFile(TEST_DATA_DIR "/184l_lig.sdf");
+  model m;
+  BOOST_REQUIRE(mols.readMoleculeIntoModel(m));
+
+  vec corner1(max_fl, max_fl, max_fl), corner2(-max_fl, -max_fl, -max_fl);
+  VINA_FOR(i, m.num_movable_atoms()) {
+    VINA_FOR(d, 3) {
+      corner1[d] = std::min(corner1[d], m.coords[i][d] - 4);
+      corner2[d] = std::max(corner2[d], m.coords[i][d] + 4);
+    }
+  }
+  grid_dims gd;
+  VINA_FOR(i, 3) {
+    gd[i].n = sz(std::ceil((corner2[i] - corner1[i] + 8) / granularity));
+    gd[i].begin = corner1[i] - 4;
+    gd[i].end = gd[i].begin + granularity * gd[i].n;
+  }
+
+  grid user_grid;
+  cache c("scoring_function_version001", gd, slope);
+  cache c16("scoring_function_version001", gd, slope, true);
+  std::vector<smt> atom_types_needed;
+  m.get_movable_atom_types(atom_types_needed);
+  c.populate(m, prec, atom_types_needed, user_grid, false);
+  c16.populate(m, prec, atom_types_needed, user_grid, false);
+
+  //bfloat16 keeps 8 bits of precision, so every grid value is within 2^-8
+  //of its float, and so is any interpolation of them; the crystal pose
+  //comes first, then random poses in the box
+  fl max_dev = 0, sum_dev = 0;
+  const unsigned n = 50;
+  VINA_FOR(i, n) {
+    conf x = m.get_initial_conf(false);
+    if (i > 0) x.randomize(corner1, corner2, generator);
+    change g(m.get_size(), false), g16(m.get_size(), false);
+    fl e = m.eval_deriv(prec, c, v, x, g, user_grid);
+    fl e16 = m.eval_deriv(prec, c16, v, x, g16, user_grid);
+    fl dev = std::fabs(e16 - e);
+    max_dev = std::max(max_dev, dev);
+    sum_dev += dev;
+    BOOST_REQUIRE_SMALL(e16 - e, (fl )0.01 + (fl )0.01 * std::fabs(e));
+  }
+  p_args.log << "bfloat16 energy deviation max: " << max_dev << " mean: "
+      << sum_dev / n << "\n\n";
+}
+
+//score the ligand of m moved so its first atom is at pos, with and without
+//cells, and require the exact same energy
+static void check_cells_at(model& m, const naive_non_cache& full,
+    const naive_non_cache& binned, const vec& pos) {
+  const fl v = 10;
+  conf x = m.get_initial_conf(false);
+  m.set(x);
+  x.ligands[0].rigid.position += pos - m.coords[0];
+  m.set(x);
+  fl e = full.eval(m, v);
+  fl ecells = binned.eval(m, v);
+  BOOST_REQUIRE_EQUAL(e, ecells);
+}
+
+void test_grid_cells() {
+  p_args.log << "Receptor Cells Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << "\n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+  rng generator(static_cast<rng::result_type>(p_args.seed));
+
+  custom_terms t;
+  t.add("gauss(o=0,_w=0.5,_c=8)", -0.035579);
+  t.add("gauss(o=3,_w=2,_c=8)", -0.005156);
+  t.add("repulsion(o=0,_c=8)", 0.840245);
+  t.add("hydrophobic(g=0.5,_b=1.5,_c=8)", -0.035069);
+  t.add("non_dir_h_bond(g=-0.7,_b=0,_c=8)", -0.587439);
+  weighted_terms wt(&t, t.weights());
+  precalculate_exact prec(wt);
+
+  FlexInfo finfo(p_args.log);
+  MolGetter mols;
+  mols.create_init_model(TEST_DATA_DIR "/184l_rec.pdb", "", finfo, p_args.log);
+  mols.setInputFile(TEST_DATA_DIR "/184l_lig.sdf");
+  model m;
+  BOOST_REQUIRE(mols.readMoleculeIntoModel(m));
+
+  receptor_cells cells(m, prec.cutoff_sqr());
+  BOOST_REQUIRE(cells.usable(m, prec.cutoff_sqr()));
+  naive_non_cache full(&prec);
+  naive_non_cache binned(&prec, &cells);
+
+  //cells are cubes half the cutoff on a side from the low corner of the
+  //scorable receptor atoms
+  const fl side = std::sqrt(prec.cutoff_sqr()) / 2;
+  vec lo(max_fl, max_fl, max_fl), hi(-max_fl, -max_fl, -max_fl);
+  const atomv& rec = m.get_fixed_atoms();
+  VINA_FOR_IN(i, rec) {
+    smt type = rec[i].get();
+    if (type >= num_atom_types() || is_hydrogen(type)) continue;
+    VINA_FOR(d, 3) {
+      lo[d] = std::min(lo[d], rec[i].coords[d]);
+      hi[d] = std::max(hi[d], rec[i].coords[d]);
+    }
+  }
+
+  //the crystal pose and random positions inside the receptor
+  check_cells_at(m, full, binned, m.coords[0]);
+  VINA_FOR(i, 20) {
+    vec pos;
+    VINA_FOR(d, 3)
+      pos[d] = random_fl(lo[d], hi[d], generator);
+    check_cells_at(m, full, binned, pos);
+  }
+
+  //on and next to cell boundaries
+  VINA_FOR(i, 20) {
+    vec pos;
+    VINA_FOR(d, 3) {
+      int cell = random_int(0, int((hi[d] - lo[d]) / side), generator);
+      pos[d] = lo[d] + cell * side;
+    }
+    check_cells_at(m, full, binned, pos);
+    const fl offsets[] = { 1e-4, -1e-4 };
+    for (fl off : offsets)
+      check_cells_at(m, full, binned, pos + vec(off, off, off));
+  }
+
+  //outside the bounding box of the receptor, within and beyond the cutoff
+  const fl cutoff = std::sqrt(prec.cutoff_sqr());
+  const fl dists[] = { cutoff / 4, fl(cutoff - 1e-4), cutoff, cutoff + 1,
+      3 * cutoff };
+  for (fl dist : dists) {
+    VINA_FOR(d, 3) {
+      vec pos = 0.5 * (lo + hi);
+      pos[d] = hi[d] + dist;
+      check_cells_at(m, full, binned, pos);
+      pos[d] = lo[d] - dist;
+      check_cells_at(m, full, binned, pos);
+    }
+    check_cells_at(m, full, binned, hi + vec(dist, dist, dist));
+    check_cells_at(m, full, binned, lo - vec(dist, dist, dist));
+  }
+}
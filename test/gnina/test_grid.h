@@ -0,0 +1,4 @@
+#pragma once
+
+void test_grid_bf16();
+void test_grid_cells();
@@ -0,0 +1,76 @@
+#include <random>
+#include <cmath>
+#include "common.h"
+#include "model.h"
+#include "mutate.h"
+#include "cache.h"
+#include "custom_terms.h"
+#include "weighted_terms.h"
+#include "precalculate.h"
+#include "test_mutate.h"
+#include "test_utils.h"
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+void test_eval_mutated() {
+  p_args.log << "Incremental Mutation Eval Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << "\n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+  std::mt19937 engine(p_args.seed);
+  rng generator(static_cast<rng::result_type>(p_args.seed));
+
+  //set up scoring function
+  custom_terms t;
+  t.add("gauss(o=0,_w=0.5,_c=8)", -0.035579);
+  t.add("gauss(o=3,_w=2,_c=8)", -0.005156);
+  t.add("repulsion(o=0,_c=8)", 0.840245);
+  t.add("hydrophobic(g=0.5,_b=1.5,_c=8)", -0.035069);
+  t.add("non_dir_h_bond(g=-0.7,_b=0,_c=8)", -0.587439);
+  weighted_terms wt(&t, t.weights());
+  precalculate_splines prec(wt, 10);
+  const vec v(10, 1.5, 10); //hunt cap, so intramolecular clashes are capped
+  const fl granularity = 0.375;
+  const fl slope = 10;
+
+  std::unique_ptr<model> m(make_two_ligand_model(engine));
+  grid_dims gd;
+  for (size_t i = 0; i < 3; ++i) {
+    gd[i].n = sz(std::ceil(16 / granularity));
+    gd[i].begin = -8;
+    gd[i].end = gd[i].begin + granularity * gd[i].n;
+  }
+  grid user_grid;
+  cache c("scoring_function_version001", gd, slope);
+  std::vector<smt> atom_types_needed;
+  m->get_movable_atom_types(atom_types_needed);
+  c.populate(*m, prec, atom_types_needed, user_grid, false);
+  BOOST_REQUIRE(c.can_eval_atom());
+
+  //walk a chain of mutations, comparing each incremental evaluation against
+  //setting and evaluating the mutated conf from scratch
+  const vec corner1(-6, -6, -6), corner2(6, 6, 6);
+  conf current(m->get_size(), false);
+  current.randomize(corner1, corner2, generator);
+  fl e = m->eval(prec, c, v, current, user_grid);
+  model full(*m);
+
+  for (unsigned step = 0; step < 200; step++) {
+    conf next = current;
+    conf_mutation mut;
+    mutate_conf(next, *m, 2, generator, &mut);
+
+    fl inc_e = m->eval_mutated(prec, c, v, next, mut, e);
+    fl full_e = full.eval(prec, c, v, next, user_grid);
+
+    for (sz i = 0; i < m->coords.size(); i++)
+      for (sz j = 0; j < 3; j++)
+        BOOST_REQUIRE_EQUAL(m->coords[i][j], full.coords[i][j]);
+    BOOST_REQUIRE_SMALL(inc_e - full_e,
+        (fl )1e-3 * std::max((fl )1, std::fabs(full_e)));
+
+    current = next;
+    e = full_e;
+  }
+}
@@ -5,6 +5,10 @@
 #include "test_gpucode.h"
 #include "test_tree.h"
 #include "test_cache.h"
+#include "test_mutate.h"
+#include "test_bgzf.h"
+#include "test_grid.h"
+#include "test_screening.h"
 #include "test_cnn.h"
 #include "test_utils.h"
 #define N_ITERS 5
@@ -56,6 +60,62 @@ BOOST_AUTO_TEST_CASE(eval_deriv) {
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(test_grid)
+
+BOOST_AUTO_TEST_CASE(bf16) {
+  boost_loop_test(&test_grid_bf16);
+}
+
+BOOST_AUTO_TEST_CASE(cells) {
+  boost_loop_test(&test_grid_cells);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(test_mutate)
+
+BOOST_AUTO_TEST_CASE(eval_mutated) {
+  boost_loop_test(&test_eval_mutated);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(test_bgzf)
+
+BOOST_AUTO_TEST_CASE(roundtrip) {
+  boost_loop_test(&test_bgzf_roundtrip);
+}
+
+BOOST_AUTO_TEST_CASE(multi_member) {
+  boost_loop_test(&test_bgzf_multi_member);
+}
+
+BOOST_AUTO_TEST_CASE(truncated) {
+  boost_loop_test(&test_bgzf_truncated);
+}
+
+BOOST_AUTO_TEST_CASE(plain_gzip) {
+  boost_loop_test(&test_bgzf_plain_gzip);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(test_screening)
+
+BOOST_AUTO_TEST_CASE(warmup) {
+  boost_loop_test(&test_screening_warmup);
+}
+
+BOOST_AUTO_TEST_CASE(quantile) {
+  boost_loop_test(&test_screening_quantile);
+}
+
+BOOST_AUTO_TEST_CASE(empty_box) {
+  boost_loop_test(&test_screening_empty_box);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_SUITE(test_cnn)
 
 BOOST_AUTO_TEST_CASE(set_atom_gradients) {
@@ -66,6 +126,14 @@ BOOST_AUTO_TEST_CASE(vanilla_grids) {
   boost_loop_test(&test_vanilla_grids);
 }
 
+BOOST_AUTO_TEST_CASE(simplified_net) {
+  boost_loop_test(&test_simplified_net);
+}
+
+BOOST_AUTO_TEST_CASE(inference_only) {
+  boost_loop_test(&test_inference_only);
+}
+
 #if 0
 BOOST_AUTO_TEST_CASE(subcube_grids) {
   boost_loop_test(&test_subcube_grids);
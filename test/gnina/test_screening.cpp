@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+#include "screening.h"
+#include "test_screening.h"
+#include "test_utils.h"
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+void test_screening_warmup() {
+  p_args.log << "Screening Warmup Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << '\n';
+  p_args.log << "Iteration " << p_args.iter_count << '\n';
+  std::mt19937 engine(p_args.seed);
+  std::uniform_real_distribution<fl> dist(-10, 10);
+
+  screening_filter off;
+  BOOST_CHECK(!off.enabled());
+  for (unsigned i = 0; i < 50; i++)
+    BOOST_CHECK(off.accept(dist(engine)));
+
+  //everything is accepted during warmup, even scores that keep getting worse
+  const sz warmup = 20;
+  screening_filter f(0.1, warmup);
+  BOOST_CHECK(f.enabled());
+  for (sz i = 0; i < warmup; i++)
+    BOOST_CHECK(f.accept(-fl(i)));
+
+  //afterwards a score has to make the top 10%
+  BOOST_CHECK(!f.accept(-fl(warmup)));
+  BOOST_CHECK(f.accept(1));
+}
+
+void test_screening_quantile() {
+  p_args.log << "Screening Quantile Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << '\n';
+  p_args.log << "Iteration " << p_args.iter_count << '\n';
+  std::mt19937 engine(p_args.seed);
+  std::uniform_real_distribution<fl> dist(-10, 10);
+  std::uniform_int_distribution<int> tie(0, 9);
+
+  //compare against the best ceil(fraction*seen) scores of everything seen,
+  //with some repeated scores to exercise ties at the threshold
+  const fl fractions[] = { 0.01, 0.1, 0.25, 0.5 };
+  for (fl fraction : fractions) {
+    const sz warmup = 10;
+    screening_filter f(fraction, warmup);
+    std::vector<fl> seen;
+    for (unsigned i = 0; i < 1000; i++) {
+      fl score = dist(engine);
+      if (!seen.empty() && tie(engine) == 0) score = seen[i / 2];
+      seen.push_back(score);
+
+      std::vector<fl> sorted(seen);
+      std::sort(sorted.begin(), sorted.end(), std::greater<fl>());
+      sz want = std::max(sz(1), sz(std::ceil(fraction * seen.size())));
+      bool expected = seen.size() <= warmup || score >= sorted[want - 1];
+      BOOST_REQUIRE_EQUAL(f.accept(score), expected);
+    }
+  }
+}
+
+void test_screening_empty_box() {
+  p_args.log << "Screening Empty Box Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << '\n';
+  p_args.log << "Iteration " << p_args.iter_count << '\n';
+  std::mt19937 engine(p_args.seed);
+  std::uniform_real_distribution<fl> dist(-10, 10);
+
+  //a ligand with no pose in the box scores below everything, whatever the order
+  output_type none(conf(), max_fl);
+  none.cnnscore = 1;
+  none.cnnaffinity = 10;
+  BOOST_CHECK_EQUAL(screening_filter::score(none, Energy), -max_fl);
+  BOOST_CHECK_EQUAL(screening_filter::score(none, CNNscore), -max_fl);
+  BOOST_CHECK_EQUAL(screening_filter::score(none, CNNaffinity), -max_fl);
+
+  output_type docked(conf(), -7);
+  docked.cnnscore = 0.8;
+  docked.cnnaffinity = 6;
+  BOOST_CHECK_EQUAL(screening_filter::score(docked, Energy), 7);
+  BOOST_CHECK_EQUAL(screening_filter::score(docked, CNNscore), fl(0.8));
+  BOOST_CHECK_EQUAL(screening_filter::score(docked, CNNaffinity), 6);
+
+  //it is accepted during warmup and rejected after it, even when everything
+  //in the top fraction so far had nothing in the box
+  screening_filter f(0.5, 1);
+  BOOST_CHECK(f.accept(-max_fl));
+  BOOST_CHECK(!f.accept(-max_fl));
+  BOOST_CHECK(!f.accept(-max_fl));
+  for (unsigned i = 0; i < 20; i++)
+    f.accept(dist(engine));
+  BOOST_CHECK(!f.accept(-max_fl));
+  BOOST_CHECK(f.accept(10));
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+void test_screening_warmup();
+void test_screening_quantile();
+void test_screening_empty_box();
@@ -10,6 +10,7 @@
 #include "parsed_args.h"
 #include "atom_constants.h"
 #include "device_buffer.h"
+#include "model.h"
 
 extern parsed_args p_args;
 extern bool run_on_gpu;
@@ -98,6 +99,105 @@ inline void set_cnn_grids(caffe::MolGridDataLayer<Dtype>* mgrid, std::vector<ato
   mgrid->setLabels(1.0,0);
 }
 
+//build the branches below node from parents, the parent node of every node
+inline branches make_branches(sz node, const std::vector<sz>& parents,
+    const std::vector<segment>& segments) {
+  branches ret;
+  for (sz i = 1; i < parents.size(); i++) {
+    if (parents[i] != node) continue;
+    ret.push_back(branch(segments[i]));
+    ret.back().children = make_branches(i, parents, segments);
+  }
+  return ret;
+}
+
+//add a ligand with a random torsion tree over atoms [begin,end) of m and
+//pairs between atoms of different nodes
+inline void make_ligand(model& m, sz begin, sz end, std::mt19937& engine) {
+  //split into nodes of 1-4 atoms, each hanging from a random earlier node
+  std::vector<sz> starts, parents;
+  std::uniform_int_distribution<sz> node_size(1, 4);
+  for (sz i = begin; i < end; i += node_size(engine)) {
+    starts.push_back(i);
+    parents.push_back(
+        parents.empty() ?
+            0 : std::uniform_int_distribution<sz>(0, parents.size() - 1)(engine));
+  }
+  starts.push_back(end);
+  sz nnodes = parents.size();
+
+  //atoms are stored relative to the origin of their node
+  std::vector<sz> node_of(end - begin);
+  for (sz n = 0; n < nnodes; n++) {
+    const vec origin = m.coords[starts[n]];
+    for (sz i = starts[n]; i < starts[n + 1]; i++) {
+      node_of[i - begin] = n;
+      m.atoms[i].coords = m.coords[i] - origin;
+    }
+  }
+
+  rigid_body root(m.coords[starts[0]], starts[0], starts[1]);
+  std::vector<segment> segments(nnodes);
+  for (sz n = 1; n < nnodes; n++) {
+    frame parent_frame(m.coords[starts[parents[n]]]);
+    segments[n] = segment(m.coords[starts[n]], starts[n], starts[n + 1],
+        m.coords[starts[parents[n]]], parent_frame);
+  }
+  flexible_body body(root);
+  body.children = make_branches(0, parents, segments);
+  m.ligands.push_back(ligand(body, nnodes - 1));
+  ligand& lig = m.ligands.back();
+  lig.begin = begin;
+  lig.end = end;
+
+  std::uniform_int_distribution<sz> atom_dist(begin, end - 1);
+  for (sz k = 0; k < 4 * (end - begin); k++) {
+    sz a = atom_dist(engine), b = atom_dist(engine);
+    if (a >= b || node_of[a - begin] == node_of[b - begin]) continue;
+    lig.pairs.push_back(
+        interacting_pair(m.atoms[a].get(), m.atoms[b].get(), a, b));
+  }
+}
+
+//a model of two small ligands with random torsion trees, pairs within and
+//between them, and a receptor around a 16A box centered on the origin
+inline model* make_two_ligand_model(std::mt19937& engine) {
+  std::vector<atom_params> lig_atoms;
+  std::vector<smt> lig_types;
+  make_mol(lig_atoms, lig_types, engine, 0, 10, 40, 4, 4, 4);
+  model* m = new model;
+  m->m_num_movable_atoms = lig_atoms.size();
+  m->minus_forces = std::vector<vec>(m->m_num_movable_atoms);
+  for (size_t i = 0; i < lig_atoms.size(); ++i) {
+    m->coords.push_back(*(vec*) &lig_atoms[i]);
+    m->atoms.push_back(atom());
+    m->atoms[i].sm = lig_types[i];
+    m->atoms[i].charge = lig_atoms[i].charge;
+  }
+  sz half = lig_atoms.size() / 2;
+  make_ligand(*m, 0, half, engine);
+  make_ligand(*m, half, lig_atoms.size(), engine);
+  std::uniform_int_distribution<sz> first(0, half - 1), second(half,
+      lig_atoms.size() - 1);
+  for (sz k = 0; k < lig_atoms.size(); k++) {
+    sz a = first(engine), b = second(engine);
+    m->other_pairs.push_back(
+        interacting_pair(m->atoms[a].get(), m->atoms[b].get(), a, b));
+  }
+
+  //receptor around a 16A box centered on the origin
+  std::vector<atom_params> rec_atoms;
+  std::vector<smt> rec_types;
+  make_mol(rec_atoms, rec_types, engine, 0, 100, 300, 12, 12, 12);
+  for (size_t i = 0; i < rec_atoms.size(); ++i) {
+    m->grid_atoms.push_back(atom());
+    m->grid_atoms[i].sm = rec_types[i];
+    m->grid_atoms[i].charge = rec_atoms[i].charge;
+    m->grid_atoms[i].coords = *(vec*) &rec_atoms[i];
+  }
+  return m;
+}
+
 //loop boost test case for energy/force calculations
 inline void boost_loop_test(void (*func)()) {
   p_args.iter_count = 0;